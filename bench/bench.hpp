@@ -0,0 +1,126 @@
+#pragma once
+
+# include <chrono>
+# include <string>
+# include <vector>
+# include <cstdint>
+# include <functional>
+# include "ecs.hpp"
+
+namespace fengin::bench
+{
+    // Handed to a scenario : its size, and measure() to time the part that
+    // matters. Setup outside measure() is not counted.
+    class   Context
+    {
+        std::size_t n;
+        std::vector<double> &samples;
+    public:
+        Context(std::size_t n, std::vector<double> &samples): n(n), samples(samples) {}
+
+        std::size_t size() const noexcept { return n; }
+
+        // Times fun once, counted as items operations.
+        template <typename Fun>
+        void measure(std::size_t items, Fun &&fun)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            fun();
+            const auto end = std::chrono::steady_clock::now();
+            samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() / std::max<std::size_t>(items, 1));
+        }
+    };
+
+    struct  Scenario
+    {
+        std::string name;
+        std::vector<std::size_t> sizes;
+        std::function<void(Context &)> run;
+    };
+
+    inline std::vector<Scenario> &scenarios()
+    {
+        static std::vector<Scenario> all;
+        return all;
+    }
+
+    struct  Registrar
+    {
+        Registrar(std::string const &name, std::vector<std::size_t> sizes, std::function<void(Context &)> run)
+        {
+            scenarios().push_back({name, std::move(sizes), std::move(run)});
+        }
+    };
+
+    // Runs a body as a system, so that what it creates is owned like in a
+    // real game and run() frames include the whole engine.
+    class   Driver : public System
+    {
+    public:
+        static inline Driver *latest{nullptr};
+        std::function<void(float)> body{[](float){}};
+
+        Driver() { name = "Bench"; latest = this; }
+        void run(float elapsed) override { body(elapsed); }
+    };
+
+    // An EntityManager with its Mediator and a Driver system, built fresh for
+    // every repetition. Removing the Driver frees what it smartCreate'd.
+    struct  World
+    {
+        EventManager events;
+        EntityManager manager;
+        Driver *driver{nullptr};
+
+        World()
+        {
+            manager.provideEventManager(events);
+            manager.addSystem<Driver>();
+            driver = Driver::latest;
+        }
+
+        ~World()
+        {
+            manager.removeSystem(driver->getName());
+            manager.cleanSystems();
+        }
+
+        // Calls fun from inside a frame, as the Driver system.
+        template <typename Fun>
+        void inFrame(Fun &&fun)
+        {
+            driver->body = [&fun](float) { fun(); };
+            manager.run();
+            driver->body = [](float) {};
+        }
+    };
+
+    // Fixed seed xorshift, so every run sees the same sequence.
+    class   Random
+    {
+        std::uint64_t state;
+    public:
+        explicit Random(std::uint64_t seed = 0x9e3779b97f4a7c15ull): state(seed) {}
+
+        std::uint64_t next() noexcept
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+
+        float unit() noexcept
+        {
+            return static_cast<float>(next() >> 40) / static_cast<float>(1 << 24);
+        }
+    };
+}
+
+# define FENGIN_BENCH_CONCAT_(a, b) a##b
+# define FENGIN_BENCH_CONCAT(a, b) FENGIN_BENCH_CONCAT_(a, b)
+// FENGIN_BENCH("name", {sizes...}) { body using ctx }
+# define FENGIN_BENCH(name, ...) \
+    static void FENGIN_BENCH_CONCAT(bench_, __LINE__)(fengin::bench::Context &ctx); \
+    static fengin::bench::Registrar FENGIN_BENCH_CONCAT(registrar_, __LINE__)(name, __VA_ARGS__, FENGIN_BENCH_CONCAT(bench_, __LINE__)); \
+    static void FENGIN_BENCH_CONCAT(bench_, __LINE__)(fengin::bench::Context &ctx)
@@ -0,0 +1,52 @@
+# include <cmath>
+# include "bench.hpp"
+# include "components.hpp"
+# include "broadphase.hpp"
+
+using namespace fengin;
+using namespace fengin::bench;
+
+// Crowd walking around : every entity moves every frame, with a handful
+// of neighbours in reach. Measures a whole frame, per entity.
+FENGIN_BENCH("broadphase/crowd", {10000, 50000})
+{
+    World world;
+    world.manager.addSystem<Broadphase>(2.f);
+    const float side = 2.f * std::sqrt(static_cast<float>(ctx.size()));
+    Random random;
+    std::vector<Entity *> entities;
+    std::vector<Aabb> steps;
+    world.inFrame([&]() {
+        for (std::size_t i = 0; i < ctx.size(); i++) {
+            const float x = random.unit() * side;
+            const float y = random.unit() * side;
+            auto &entity = world.manager.smartCreate<Particle>();
+            entity.attach<Bounds>(x - .5f, y - .5f, x + .5f, y + .5f);
+            entities.push_back(&entity);
+            const float dx = random.unit() * .2f - .1f;
+            const float dy = random.unit() * .2f - .1f;
+            steps.push_back({dx, dy, dx, dy});
+        }
+    });
+    world.manager.run();
+    std::size_t collisions = 0;
+    world.driver->body = [&](float) {
+        collisions += world.manager.read<events::Collision>().size();
+        for (std::size_t i = 0; i < entities.size(); i++) {
+            auto &box = entities[i]->modify<Bounds>().box;
+            box.minX += steps[i].minX;
+            box.maxX += steps[i].maxX;
+            box.minY += steps[i].minY;
+            box.maxY += steps[i].maxY;
+        }
+    };
+    for (int frame = 0; frame < 10; frame++) {
+        ctx.measure(ctx.size(), [&]() {
+            world.manager.run();
+        });
+    }
+    world.driver->body = [](float) {};
+    world.manager.removeSystem("Broadphase");
+    if (collisions == 0)
+        std::abort();
+}
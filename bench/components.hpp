@@ -0,0 +1,69 @@
+#pragma once
+
+# include "ecs.hpp"
+
+namespace fengin::bench
+{
+    struct  Position : public Component
+    {
+        float x{0};
+        float y{0};
+        float z{0};
+
+        Position() = default;
+        Position(float x, float y, float z): x(x), y(y), z(z) {}
+
+        template <typename Archive>
+        void snapshot(Archive &ar) { ar(x, y, z); }
+    };
+
+    struct  Velocity : public Component
+    {
+        float dx{1};
+        float dy{1};
+        float dz{1};
+
+        template <typename Archive>
+        void snapshot(Archive &ar) { ar(dx, dy, dz); }
+    };
+
+    struct  Health : public Component
+    {
+        int value{100};
+
+        template <typename Archive>
+        void snapshot(Archive &ar) { ar(value); }
+    };
+
+    // Plain data twins of Position and Velocity : no vtable nor back
+    // references, 12 bytes each.
+    struct  PlainPosition
+    {
+        float x;
+        float y;
+        float z;
+    };
+
+    struct  PlainVelocity
+    {
+        float dx{1};
+        float dy{1};
+        float dz{1};
+    };
+
+    // Bare entity : components are attached by the scenarios.
+    class   Particle : public Entity
+    {
+    };
+
+    // Entity attaching its components from its constructor, like game entities do.
+    class   Mover : public Entity
+    {
+    public:
+        Mover(float x, float y)
+        {
+            attach<Position>(x, y, 0.f);
+            attach<Velocity>();
+        }
+    };
+}
@@ -0,0 +1,254 @@
+# include <numeric>
+# include "bench.hpp"
+# include "components.hpp"
+
+using namespace fengin;
+using namespace fengin::bench;
+
+FENGIN_BENCH("entity/create", {1000, 100000})
+{
+    World world;
+    world.inFrame([&]() {
+        ctx.measure(ctx.size(), [&]() {
+            for (std::size_t i = 0; i < ctx.size(); i++)
+                world.manager.smartCreate<Mover>(float(i), 0.f);
+        });
+    });
+}
+
+FENGIN_BENCH("entity/destroy", {1000, 100000})
+{
+    World world;
+    std::vector<Entity *> entities;
+    world.inFrame([&]() {
+        for (std::size_t i = 0; i < ctx.size(); i++)
+            entities.push_back(&world.manager.smartCreate<Mover>(float(i), 0.f));
+        // Destroy in a shuffled order, as gameplay does.
+        Random random;
+        for (std::size_t i = entities.size(); i > 1; i--)
+            std::swap(entities[i - 1], entities[random.next() % i]);
+        ctx.measure(ctx.size(), [&]() {
+            for (auto entity: entities)
+                world.manager.destroy(*entity);
+        });
+    });
+}
+
+// Spawn and despawn storm : half of the entities replaced every frame.
+FENGIN_BENCH("entity/churn_frame", {1000, 100000})
+{
+    World world;
+    std::vector<Entity *> entities;
+    world.inFrame([&]() {
+        for (std::size_t i = 0; i < ctx.size(); i++)
+            entities.push_back(&world.manager.smartCreate<Mover>(float(i), 0.f));
+    });
+    Random random;
+    for (int frame = 0; frame < 10; frame++) {
+        world.inFrame([&]() {
+            ctx.measure(ctx.size(), [&]() {
+                for (std::size_t i = 0; i < entities.size() / 2; i++) {
+                    auto &slot = entities[random.next() % entities.size()];
+                    world.manager.destroy(*slot);
+                    slot = &world.manager.smartCreate<Mover>(float(i), 0.f);
+                }
+            });
+        });
+    }
+}
+
+FENGIN_BENCH("entity/create_transient", {1000, 100000})
+{
+    World world;
+    world.inFrame([&]() {
+        ctx.measure(ctx.size(), [&]() {
+            for (std::size_t i = 0; i < ctx.size(); i++)
+                world.manager.createTransient<Mover>(float(i), 0.f);
+        });
+    });
+}
+
+FENGIN_BENCH("component/attach", {1000, 100000})
+{
+    World world;
+    world.inFrame([&]() {
+        std::vector<Entity *> entities;
+        for (std::size_t i = 0; i < ctx.size(); i++)
+            entities.push_back(&world.manager.smartCreate<Particle>());
+        ctx.measure(ctx.size(), [&]() {
+            for (auto entity: entities)
+                entity->attach<Health>();
+        });
+    });
+}
+
+FENGIN_BENCH("component/detach", {1000, 100000})
+{
+    World world;
+    world.inFrame([&]() {
+        std::vector<Entity *> entities;
+        for (std::size_t i = 0; i < ctx.size(); i++)
+            entities.push_back(&world.manager.smartCreate<Mover>(float(i), 0.f));
+        ctx.measure(ctx.size(), [&]() {
+            for (auto entity: entities)
+                entity->detach<Velocity>();
+        });
+    });
+}
+
+FENGIN_BENCH("component/detach_batch", {1000, 100000})
+{
+    World world;
+    world.inFrame([&]() {
+        std::vector<Entity *> entities;
+        for (std::size_t i = 0; i < ctx.size(); i++)
+            entities.push_back(&world.manager.smartCreate<Mover>(float(i), 0.f));
+        ctx.measure(ctx.size(), [&]() {
+            world.manager.detach<Velocity>(entities);
+        });
+    });
+}
+
+// Worlds where one entity in four lacks Velocity, and one in two has Health.
+// Resolves component handles kept across destructions : the ids of the
+// destroyed half are reused, and their handles must not reach the newcomers.
+FENGIN_BENCH("component/handle_get", {1000, 100000})
+{
+    World world;
+    std::vector<ComponentHandle<Position>> handles;
+    world.inFrame([&]() {
+        std::vector<Entity *> entities;
+        for (std::size_t i = 0; i < ctx.size(); i++) {
+            entities.push_back(&world.manager.smartCreate<Mover>(float(i), 0.f));
+            handles.push_back(entities.back()->handle<Position>());
+        }
+        for (std::size_t i = 0; i < entities.size(); i += 2)
+            world.manager.destroy(*entities[i]);
+        for (std::size_t i = 0; i < entities.size(); i += 2)
+            world.manager.smartCreate<Mover>(float(i), 0.f);
+    });
+    std::size_t live = 0;
+    ctx.measure(ctx.size(), [&]() {
+        for (auto const &handle: handles)
+            live += handle.get() != nullptr;
+    });
+    if (live != ctx.size() / 2)
+        std::abort();
+}
+
+static void populate(World &world, std::size_t n)
+{
+    world.inFrame([&]() {
+        for (std::size_t i = 0; i < n; i++) {
+            auto &entity = world.manager.smartCreate<Mover>(float(i), 0.f);
+            if (i % 4 == 0)
+                entity.detach<Velocity>();
+            if (i % 2 == 0)
+                entity.attach<Health>();
+        }
+    });
+}
+
+FENGIN_BENCH("query/get", {10000, 1000000})
+{
+    World world;
+    populate(world, ctx.size());
+    float sum = 0;
+    ctx.measure(ctx.size(), [&]() {
+        for (auto position: world.manager.get<Position>())
+            sum += position->x;
+    });
+    if (sum < 0)
+        std::abort();
+}
+
+// Walks the Movers among as many Particles, by concrete type.
+FENGIN_BENCH("query/entities_of", {10000, 1000000})
+{
+    World world;
+    populate(world, ctx.size());
+    world.inFrame([&]() {
+        for (std::size_t i = 0; i < ctx.size(); i++)
+            world.manager.smartCreate<Particle>();
+    });
+    std::size_t withVelocity = 0;
+    ctx.measure(ctx.size(), [&]() {
+        for (auto &mover: world.manager.entitiesOf<Mover>())
+            withVelocity += mover.has<Velocity>();
+    });
+    if (withVelocity > ctx.size())
+        std::abort();
+}
+
+FENGIN_BENCH("query/view1", {10000, 1000000})
+{
+    World world;
+    populate(world, ctx.size());
+    ctx.measure(ctx.size(), [&]() {
+        world.manager.view<Position>().each([](Entity &, Position &position) {
+            position.x += 1;
+        });
+    });
+}
+
+FENGIN_BENCH("query/view2", {10000, 1000000})
+{
+    World world;
+    populate(world, ctx.size());
+    ctx.measure(ctx.size(), [&]() {
+        world.manager.view<Position, Velocity>().each([](Entity &, Position &position, Velocity const &velocity) {
+            position.x += velocity.dx;
+            position.y += velocity.dy;
+            position.z += velocity.dz;
+        });
+    });
+}
+
+// query/view2 over plain data components.
+FENGIN_BENCH("query/view2_plain", {10000, 1000000})
+{
+    World world;
+    world.inFrame([&]() {
+        for (std::size_t i = 0; i < ctx.size(); i++) {
+            auto &entity = world.manager.smartCreate<Particle>();
+            entity.attach<PlainPosition>(float(i), 0.f, 0.f);
+            if (i % 4 != 0)
+                entity.attach<PlainVelocity>();
+            if (i % 2 == 0)
+                entity.attach<Health>();
+        }
+    });
+    ctx.measure(ctx.size(), [&]() {
+        world.manager.view<PlainPosition, PlainVelocity>().each([](Entity &, PlainPosition &position, PlainVelocity const &velocity) {
+            position.x += velocity.dx;
+            position.y += velocity.dy;
+            position.z += velocity.dz;
+        });
+    });
+}
+
+FENGIN_BENCH("query/view3", {10000, 1000000})
+{
+    World world;
+    populate(world, ctx.size());
+    ctx.measure(ctx.size(), [&]() {
+        world.manager.view<Position, Velocity, Health>().each([](Entity &, Position &position, Velocity const &velocity, Health &health) {
+            position.x += velocity.dx;
+            health.value -= 1;
+        });
+    });
+}
+
+FENGIN_BENCH("query/parallel_view2", {1000000})
+{
+    World world;
+    world.manager.setThreadCount(std::max(2u, std::thread::hardware_concurrency()));
+    populate(world, ctx.size());
+    ctx.measure(ctx.size(), [&]() {
+        world.manager.parallelEach<Position, Velocity>([](Entity &, Position &position, Velocity const &velocity) {
+            position.x += velocity.dx;
+            position.y += velocity.dy;
+            position.z += velocity.dz;
+        });
+    });
+}
@@ -0,0 +1,129 @@
+# include "bench.hpp"
+# include "components.hpp"
+# include "events.hpp"
+
+using namespace fengin;
+using namespace fengin::bench;
+
+namespace
+{
+    struct  Ping
+    {
+        int value;
+    };
+
+    static int received = 0;
+
+    class   Listener : public System
+    {
+    public:
+        explicit Listener(int index)
+        {
+            name = "Listener" + std::to_string(index);
+            afterBuild = [this]() {
+                addReaction<Ping>([](Event &e) {
+                    received += rebuild<Ping>(e).value;
+                });
+                subscribe<&Listener::onPing>();
+            };
+        }
+
+        void onPing(Ping const &ping)
+        {
+            received += ping.value;
+        }
+
+        void run(float) override {}
+    };
+
+    constexpr int Listeners = 64;
+
+    void listen(World &world)
+    {
+        for (int i = 0; i < Listeners; i++)
+            world.manager.addSystem<Listener>(i);
+    }
+}
+
+// Cost per handler call of Mediator::send to 64 reactions.
+FENGIN_BENCH("events/mediator_fanout", {10000})
+{
+    World world;
+    listen(world);
+    ctx.measure(ctx.size() * Listeners, [&]() {
+        for (std::size_t i = 0; i < ctx.size(); i++)
+            world.events.send<Ping>(Ping{1});
+    });
+}
+
+// Same through the typed Dispatcher.
+FENGIN_BENCH("events/dispatcher_fanout", {10000})
+{
+    World world;
+    listen(world);
+    ctx.measure(ctx.size() * Listeners, [&]() {
+        for (std::size_t i = 0; i < ctx.size(); i++)
+            world.manager.emit(Ping{1});
+    });
+}
+
+FENGIN_BENCH("events/channel_post_read", {10000, 1000000})
+{
+    World world;
+    int sum = 0;
+    world.driver->body = [&](float) {
+        for (auto &ping: world.manager.read<Ping>())
+            sum += ping.value;
+    };
+    ctx.measure(ctx.size(), [&]() {
+        for (std::size_t i = 0; i < ctx.size(); i++)
+            world.manager.post<Ping>(1);
+        world.manager.run();
+        world.manager.run();
+    });
+}
+
+FENGIN_BENCH("events/collision_batch", {100000})
+{
+    World world;
+    std::vector<EntityHandle> entities;
+    world.inFrame([&]() {
+        for (std::size_t i = 0; i < 1000; i++)
+            entities.push_back(world.manager.smartCreate<Particle>().getHandle());
+    });
+    std::size_t alive = 0;
+    world.driver->body = [&](float) {
+        for (auto &collision: world.manager.read<events::Collision>())
+            alive += world.manager.alive(collision.first) && world.manager.alive(collision.second);
+    };
+    Random random;
+    ctx.measure(ctx.size(), [&]() {
+        for (std::size_t i = 0; i < ctx.size(); i++)
+            world.manager.post<events::Collision>(entities[random.next() % entities.size()], entities[random.next() % entities.size()]);
+        world.manager.run();
+        world.manager.run();
+    });
+}
+
+// Four threads enqueueing, the main thread draining.
+FENGIN_BENCH("events/enqueue_drain", {100000})
+{
+    World world;
+    listen(world);
+    ctx.measure(ctx.size(), [&]() {
+        std::vector<std::thread> producers;
+        std::atomic<long> left{static_cast<long>(ctx.size())};
+        for (int t = 0; t < 4; t++) {
+            producers.emplace_back([&]() {
+                while (left.fetch_sub(1, std::memory_order_relaxed) > 0) {
+                    while (!world.manager.enqueue<Ping>(1))
+                        std::this_thread::yield();
+                }
+            });
+        }
+        while (world.manager.getQueueStats().delivered < ctx.size())
+            world.manager.run();
+        for (auto &producer: producers)
+            producer.join();
+    });
+}
@@ -0,0 +1,86 @@
+# include "bench.hpp"
+# include "components.hpp"
+
+using namespace fengin;
+using namespace fengin::bench;
+
+namespace
+{
+    class   Movement : public System
+    {
+    public:
+        explicit Movement(int index)
+        {
+            name = "Movement" + std::to_string(index);
+            reads<Velocity>();
+            writes<Position>();
+        }
+
+        void run(float elapsed) override
+        {
+            entityManager->view<Position, Velocity>().each([elapsed](Entity &, Position &position, Velocity const &velocity) {
+                position.x += velocity.dx * elapsed;
+                position.y += velocity.dy * elapsed;
+            });
+        }
+    };
+
+    class   Damage : public System
+    {
+    public:
+        Damage(int index, float period)
+        {
+            name = "Damage" + std::to_string(index);
+            writes<Health>();
+            if (period > 0)
+                runEvery(period);
+        }
+
+        void run(float) override
+        {
+            entityManager->view<Health>().each([](Entity &, Health &health) {
+                health.value = health.value > 0 ? health.value - 1 : 100;
+            });
+        }
+    };
+
+    // Frames of a 60 Hz loop. Damage systems run every damagePeriod seconds, or every frame.
+    void frame(Context &ctx, unsigned int threads, float damagePeriod = 0)
+    {
+        World world;
+        if (threads > 0)
+            world.manager.setThreadCount(threads);
+        world.inFrame([&]() {
+            for (std::size_t i = 0; i < ctx.size(); i++) {
+                auto &entity = world.manager.smartCreate<Mover>(float(i), 0.f);
+                if (i % 2 == 0)
+                    entity.attach<Health>();
+            }
+        });
+        for (int i = 0; i < 5; i++)
+            world.manager.addSystem<Movement>(i);
+        for (int i = 0; i < 5; i++)
+            world.manager.addSystem<Damage>(i, damagePeriod);
+        world.manager.run(1.f / 60);
+        // One measure per frame : ns per entity per frame.
+        for (int i = 0; i < 12; i++)
+            ctx.measure(ctx.size(), [&]() { world.manager.run(1.f / 60); });
+    }
+}
+
+// A whole run() with ten systems iterating the world.
+FENGIN_BENCH("frame/run", {10000, 1000000})
+{
+    frame(ctx, 0);
+}
+
+FENGIN_BENCH("frame/run_parallel", {10000, 1000000})
+{
+    frame(ctx, std::max(2u, std::thread::hardware_concurrency()));
+}
+
+// Damage at 10 Hz : its systems skip five frames out of six.
+FENGIN_BENCH("frame/run_throttled", {10000, 1000000})
+{
+    frame(ctx, 0, .1f);
+}
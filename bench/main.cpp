@@ -0,0 +1,123 @@
+//
+// fengin-bench : runs the scenarios registered with FENGIN_BENCH and prints
+// their results as JSON on stdout, and as a table on stderr.
+//
+//     fengin-bench [--filter substring] [--repetitions n] [--output file] [--list]
+//
+
+# include <cstdlib>
+# include <cstring>
+# include <fstream>
+# include <algorithm>
+# include <iostream>
+# include <iomanip>
+# include "bench.hpp"
+
+using namespace fengin::bench;
+
+namespace
+{
+    struct  Options
+    {
+        std::string filter;
+        int repetitions{5};
+        std::string output;
+        bool list{false};
+    };
+
+    struct  Result
+    {
+        std::string name;
+        std::size_t size;
+        std::vector<double> samples;      // In the order they were measured.
+        double median;
+        double min;
+        double max;
+    };
+
+    Options parse(int ac, char **av)
+    {
+        Options options;
+        for (int i = 1; i < ac; i++) {
+            const std::string arg = av[i];
+            if (arg == "--list")
+                options.list = true;
+            else if (i + 1 < ac && arg == "--filter")
+                options.filter = av[++i];
+            else if (i + 1 < ac && arg == "--repetitions")
+                options.repetitions = std::max(1, std::atoi(av[++i]));
+            else if (i + 1 < ac && arg == "--output")
+                options.output = av[++i];
+            else
+                throw std::invalid_argument("Unknown argument " + arg);
+        }
+        return options;
+    }
+
+    Result summarize(std::string const &name, std::size_t size, std::vector<double> samples)
+    {
+        auto sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+        return {name, size, std::move(samples), sorted[sorted.size() / 2], sorted.front(), sorted.back()};
+    }
+
+    void writeJson(std::ostream &out, std::vector<Result> const &results, Options const &options)
+    {
+        out << "{\"suite\":\"fengin-bench\",\"unit\":\"ns/op\",\"repetitions\":" << options.repetitions
+            << ",\"results\":[";
+        for (std::size_t i = 0; i < results.size(); i++) {
+            auto &result = results[i];
+            out << (i ? ",\n" : "\n") << "{\"name\":\"" << result.name << "\",\"size\":" << result.size
+                << ",\"median\":" << result.median << ",\"min\":" << result.min << ",\"max\":" << result.max
+                << ",\"samples\":[";
+            for (std::size_t j = 0; j < result.samples.size(); j++)
+                out << (j ? "," : "") << result.samples[j];
+            out << "]}";
+        }
+        out << "\n]}\n";
+    }
+}
+
+int main(int ac, char **av)
+{
+    Options options;
+    try {
+        options = parse(ac, av);
+    } catch (std::exception const &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    fengin::Logger::inst().setLevel(fengin::LogLevel::Warning);
+    std::vector<Result> results;
+    for (auto &scenario: scenarios()) {
+        if (scenario.name.find(options.filter) == std::string::npos)
+            continue ;
+        for (auto size: scenario.sizes) {
+            if (options.list) {
+                std::cout << scenario.name << " " << size << std::endl;
+                continue ;
+            }
+            std::vector<double> samples;
+            for (int i = 0; i < options.repetitions; i++) {
+                Context ctx(size, samples);
+                scenario.run(ctx);
+            }
+            if (samples.empty())
+                continue ;
+            results.push_back(summarize(scenario.name, size, std::move(samples)));
+            auto &result = results.back();
+            std::cerr << std::left << std::setw(32) << result.name << std::right << std::setw(10) << result.size
+                      << std::fixed << std::setprecision(2)
+                      << std::setw(12) << result.median << " ns/op (min " << result.min << ", max " << result.max << ")" << std::endl;
+        }
+    }
+    if (options.list)
+        return 0;
+    if (options.output.empty())
+        writeJson(std::cout, results, options);
+    else {
+        std::ofstream file(options.output);
+        writeJson(file, results, options);
+    }
+    return 0;
+}
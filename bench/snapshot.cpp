@@ -0,0 +1,53 @@
+# include "bench.hpp"
+# include "components.hpp"
+
+using namespace fengin;
+using namespace fengin::bench;
+
+static void registerTypes()
+{
+    auto &registry = SnapshotRegistry::inst();
+    registry.component<Position>("Position");
+    registry.component<Velocity>("Velocity");
+    registry.component<Health>("Health");
+    registry.entity<Particle>("Particle");
+}
+
+// Particles with a Position and a Velocity, one in two with Health.
+static void populate(World &world, std::size_t n)
+{
+    world.inFrame([&]() {
+        for (std::size_t i = 0; i < n; i++) {
+            auto &entity = world.manager.smartCreate<Particle>();
+            entity.attach<Position>(float(i), 0.f, 0.f);
+            entity.attach<Velocity>();
+            if (i % 2 == 0)
+                entity.attach<Health>();
+        }
+    });
+}
+
+FENGIN_BENCH("snapshot/save", {10000, 1000000})
+{
+    registerTypes();
+    World world;
+    populate(world, ctx.size());
+    std::vector<unsigned char> buffer;
+    world.manager.saveSnapshot(buffer);
+    ctx.measure(ctx.size(), [&]() {
+        world.manager.saveSnapshot(buffer);
+    });
+}
+
+FENGIN_BENCH("snapshot/load", {10000, 1000000})
+{
+    registerTypes();
+    World world;
+    populate(world, ctx.size());
+    std::vector<unsigned char> buffer;
+    world.manager.saveSnapshot(buffer);
+    world.manager.loadSnapshot(buffer.data(), buffer.size());
+    ctx.measure(ctx.size(), [&]() {
+        world.manager.loadSnapshot(buffer.data(), buffer.size());
+    });
+}
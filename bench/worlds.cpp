@@ -0,0 +1,83 @@
+# include <memory>
+# include <thread>
+# include "bench.hpp"
+# include "components.hpp"
+# include "world.hpp"
+
+using namespace fengin;
+
+namespace
+{
+    // A small match : a few hundred movers, integrated every frame.
+    class   Match : public System
+    {
+        std::size_t movers;
+    public:
+        explicit Match(std::size_t movers): movers(movers)
+        {
+            name = "Match";
+            afterBuild = [this]() {
+                for (std::size_t i = 0; i < this->movers; i++)
+                    entityManager->smartCreate<bench::Mover>(float(i), 0.f);
+            };
+        }
+
+        void run(float) override
+        {
+            entityManager->view<bench::Position, bench::Velocity>().each([](Entity &, bench::Position &position, bench::Velocity const &velocity) {
+                position.x += velocity.dx;
+                position.y += velocity.dy;
+                position.z += velocity.dz;
+            });
+        }
+    };
+
+    struct  Matches
+    {
+        ThreadPool pool{std::max(2u, std::thread::hardware_concurrency())};
+        std::vector<std::unique_ptr<fengin::World>> worlds;
+
+        explicit Matches(std::size_t count)
+        {
+            for (std::size_t i = 0; i < count; i++) {
+                worlds.push_back(std::make_unique<fengin::World>(i));
+                worlds.back()->getManager().provideThreadPool(pool);
+                worlds.back()->getManager().addSystem<Match>(std::size_t(500));
+            }
+        }
+
+        ~Matches()
+        {
+            for (auto &world: worlds) {
+                world->getManager().removeSystem("Match");
+                world->getManager().cleanSystems();
+            }
+        }
+    };
+}
+
+// A frame of every world, per world : one after the other, like one process
+// per match would, then all on the shared pool, like FenginCore runs them.
+FENGIN_BENCH("worlds/frame_sequential", {16, 256})
+{
+    Matches matches(ctx.size());
+    for (int frame = 0; frame < 10; frame++) {
+        ctx.measure(ctx.size(), [&]() {
+            for (auto &world: matches.worlds)
+                world->runFree();
+        });
+    }
+}
+
+FENGIN_BENCH("worlds/frame_pool", {16, 256})
+{
+    Matches matches(ctx.size());
+    for (int frame = 0; frame < 10; frame++) {
+        ctx.measure(ctx.size(), [&]() {
+            TaskGroup group;
+            for (auto &world: matches.worlds)
+                matches.pool.run(group, [&world]() { world->runFree(); });
+            matches.pool.wait(group);
+        });
+    }
+}
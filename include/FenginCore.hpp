@@ -14,6 +14,9 @@
 # include "utils/rendering.hpp"
 # include "events.hpp"
 # include "ecs.hpp"
+# include "plugins.hpp"
+# include "threadpool.hpp"
+# include "world.hpp"
 
 // Utils forward declarations
 namespace futils
@@ -31,17 +34,51 @@ namespace fengin
     using vec2ui = futils::Vec2<unsigned int>;
     using vec3ui = futils::Vec3<unsigned int>;
 
+    enum class LoopMode {
+        Free,   // One frame after the other, as fast as possible unless frameRate caps it.
+        Fixed   // Systems run at tickRate with a constant elapsed time, per frame systems once per iteration.
+    };
+
     struct StartParameters {
         std::string configFilePath;
         bool recursive = false;
         bool logWhenLoading = true;
         bool loadSymlinks = false;
+        unsigned int threads = 0; // Workers running systems that declare their component access, and the worlds. 0 runs everything on the main thread, unless there are several worlds.
+        unsigned int worlds = 1; // Independent worlds, each with its own entities, events and instances of the loaded systems.
+        float worldBudget = 0; // Milliseconds of work a world may do per iteration. A fixed loop world drops the ticks it could not fit. 0 : unbounded.
+        LogLevel logLevel = LogLevel::Info; // Messages below it are dropped. Levels below FENGIN_LOG_LEVEL are compiled out anyway.
+        LoopMode loop = LoopMode::Free;
+        float tickRate = 60; // Fixed ticks per second.
+        unsigned int maxCatchUpTicks = 5; // Ticks run at most per iteration when late. The rest of the delay is dropped.
+        float frameRate = 0; // Iterations per second at most. 0 : uncapped in Free mode, one per tick in Fixed mode.
+        std::size_t profileFrames = 0; // Frames kept by the profiler. 0 disables profiling.
+        std::string pluginManifest; // Caches the scan of configFilePath between starts. Empty disables it.
     };
 
     class FenginCore
     {
-        futils::UP<EntityManager> core;
-        futils::UP<EventManager> events;
+        // Shared by the worlds, so it outlives them.
+        futils::UP<ThreadPool> pool;
+        // The first one is built with the core, the others by start().
+        std::vector<futils::UP<World>> worlds;
+        StartParameters parameters;
+        PluginManifest manifest;
+
+        EntityManager &main() const {
+            return worlds.front()->getManager();
+        }
+
+        void collectSystemDir(std::string const &path, bool recursive, bool log, bool loadSymlinks,
+                              std::vector<PluginManifest::Entry *> &libraries);
+        void addWorlds(unsigned int count);
+        bool anyRunning() const;
+        int64_t framesRun() const;
+        // Calls fun(World &) for every running world, concurrently on the pool
+        // when there are several. A world throwing is stopped, the others go on.
+        void eachRunning(std::function<void(World &)> const &fun);
+        int64_t runFree();
+        int64_t runFixed();
     public:
         explicit FenginCore(std::string const &);
         int start(StartParameters params);
@@ -49,31 +86,57 @@ namespace fengin
 
         void loadSystemDir(std::string const &path, bool recursive, bool log, bool loadSymlinks);
 
+        // Loads the system of path in every world. Returns how the first one went.
         template <typename ...Args>
         LoadStatus loadSystem(std::string const &path, Args... args)
         {
-            return core->loadSystem(path, args...);
+            auto status = main().loadSystem(path, args...);
+            if (!status.loaded)
+                return status;
+            for (std::size_t i = 1; i < worlds.size(); i++)
+                worlds[i]->getManager().loadSystem(path, args...);
+            return status;
         };
 
+        // Adds a System to every world.
         template <typename System, typename ...Args>
         void addSystem(Args ...args) {
-            core->addSystem<System>(args...);
+            for (auto &world : worlds)
+                world->getManager().addSystem<System>(args...);
         };
 
         template <typename System>
         void addSystem()
         {
-            core->addSystem<System>();
+            for (auto &world : worlds)
+                world->getManager().addSystem<System>();
         }
 
         template <typename System>
         void removeSystem() {
-            core->removeSystem(futils::demangle<System>());
+            for (auto &world : worlds)
+                world->getManager().removeSystem(futils::demangle<System>());
+        }
+
+        // start() adds the worlds asked by StartParameters::worlds before
+        // loading the system directory. Systems added or loaded before that
+        // only reach the first world.
+        std::size_t getWorldCount() const {
+            return worlds.size();
+        }
+
+        World &getWorld(std::size_t index = 0) const {
+            return *worlds.at(index);
+        }
+
+        // Null unless StartParameters::profileFrames is set.
+        Profiler *getProfiler(std::size_t world = 0) const {
+            return getWorld(world).getManager().getProfiler();
         }
 
         template <typename T, typename ...Args>
         T *createEntity(Args ...args) {
-            return core->create<T>(args...);
+            return main().create<T>(args...);
         };
     };
 }
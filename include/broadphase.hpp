@@ -0,0 +1,355 @@
+#pragma once
+
+# include <cmath>
+# include <vector>
+# include <cstdint>
+# include <utility>
+# include <algorithm>
+# include <unordered_map>
+# include "ecs.hpp"
+# include "events.hpp"
+
+namespace fengin
+{
+    // Axis aligned box on the x/y plane.
+    struct  Aabb
+    {
+        float minX{0};
+        float minY{0};
+        float maxX{0};
+        float maxY{0};
+
+        bool overlaps(Aabb const &other) const noexcept
+        {
+            return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+        }
+    };
+
+    // What the Broadphase indexes. Move it through Entity::modify<Bounds>(),
+    // or the broadphase will not see the change. Plain data : snapshots copy
+    // it as is.
+    struct  Bounds
+    {
+        Aabb box;
+
+        Bounds() = default;
+        explicit Bounds(Aabb box): box(box) {}
+        Bounds(float minX, float minY, float maxX, float maxY): box{minX, minY, maxX, maxY} {}
+    };
+
+    // Uniform grid of square cells, stored sparsely : only cells holding a
+    // box exist. A box is listed in every cell it overlaps, and is only moved
+    // between cells when it crosses a cell border. Boxes are keyed by entity id.
+    // Boxes overlapping more than MaxCells cells are kept apart, and tested
+    // against every other box instead.
+    class   SpatialGrid
+    {
+    public:
+        static constexpr std::int64_t MaxCells = 1024;
+    private:
+        // Cell coordinates are clamped to it, so that far away boxes stay representable.
+        static constexpr float CellLimit = 1 << 30;
+
+        struct  Proxy
+        {
+            EntityHandle handle;
+            Aabb box;
+            int x0{0};
+            int y0{0};
+            int x1{-1};
+            int y1{-1};
+            bool large{false};
+            mutable std::uint32_t mark{0};
+        };
+
+        struct  Cell
+        {
+            int x;
+            int y;
+            std::vector<std::uint32_t> ids;
+        };
+
+        float side;
+        float inverse;
+        std::vector<Proxy> proxies;
+        std::unordered_map<std::uint64_t, std::uint32_t> cellIndex;
+        std::vector<Cell> cells;
+        std::vector<std::uint32_t> large;
+        std::size_t count{0};
+        mutable std::uint32_t stamp{0};
+
+        static std::uint64_t key(int x, int y) noexcept
+        {
+            return (std::uint64_t(std::uint32_t(x)) << 32) | std::uint32_t(y);
+        }
+
+        int cellOf(float coordinate) const noexcept
+        {
+            return static_cast<int>(std::max(-CellLimit, std::min(CellLimit, std::floor(coordinate * inverse))));
+        }
+
+        static bool finite(Aabb const &box) noexcept
+        {
+            return std::isfinite(box.minX) && std::isfinite(box.minY) && std::isfinite(box.maxX) && std::isfinite(box.maxY);
+        }
+
+        Cell &cellAt(int x, int y)
+        {
+            auto it = cellIndex.find(key(x, y));
+            if (it != cellIndex.end())
+                return cells[it->second];
+            cellIndex.emplace(key(x, y), static_cast<std::uint32_t>(cells.size()));
+            cells.push_back({x, y, {}});
+            return cells.back();
+        }
+
+        Cell const *findCell(int x, int y) const noexcept
+        {
+            auto it = cellIndex.find(key(x, y));
+            return it == cellIndex.end() ? nullptr : &cells[it->second];
+        }
+
+        // Empty cells are dropped, the last one taking their place.
+        void dropCell(std::uint32_t index)
+        {
+            cellIndex.erase(key(cells[index].x, cells[index].y));
+            if (index + 1 != cells.size()) {
+                cells[index] = std::move(cells.back());
+                cellIndex[key(cells[index].x, cells[index].y)] = index;
+            }
+            cells.pop_back();
+        }
+
+        void link(std::uint32_t id, Proxy const &proxy)
+        {
+            if (proxy.large) {
+                large.push_back(id);
+                return ;
+            }
+            for (int x = proxy.x0; x <= proxy.x1; x++) {
+                for (int y = proxy.y0; y <= proxy.y1; y++)
+                    cellAt(x, y).ids.push_back(id);
+            }
+        }
+
+        void unlink(std::uint32_t id, Proxy const &proxy)
+        {
+            if (proxy.large) {
+                auto it = std::find(large.begin(), large.end(), id);
+                if (it != large.end()) {
+                    *it = large.back();
+                    large.pop_back();
+                }
+                return ;
+            }
+            for (int x = proxy.x0; x <= proxy.x1; x++) {
+                for (int y = proxy.y0; y <= proxy.y1; y++) {
+                    auto it = cellIndex.find(key(x, y));
+                    if (it == cellIndex.end())
+                        continue ;
+                    const auto index = it->second;
+                    auto &ids = cells[index].ids;
+                    auto found = std::find(ids.begin(), ids.end(), id);
+                    if (found != ids.end()) {
+                        *found = ids.back();
+                        ids.pop_back();
+                    }
+                    if (ids.empty())
+                        dropCell(index);
+                }
+            }
+        }
+
+        bool live(std::uint32_t id) const noexcept
+        {
+            return id < proxies.size() && proxies[id].handle.valid();
+        }
+    public:
+        explicit SpatialGrid(float cellSize = 1): side(cellSize), inverse(1 / cellSize) {}
+
+        float cellSize() const noexcept { return side; }
+        std::size_t size() const noexcept { return count; }
+
+        std::size_t cellCount() const noexcept { return cells.size(); }
+
+        // Inserts or moves the box of handle's entity. A box with a NaN or
+        // infinite bound is refused, and the entity's previous box removed.
+        bool update(EntityHandle handle, Aabb const &box)
+        {
+            const auto id = handle.index;
+            if (!finite(box)) {
+                remove(id);
+                return false;
+            }
+            if (id >= proxies.size())
+                proxies.resize(id + 1);
+            auto &proxy = proxies[id];
+            const int x0 = cellOf(box.minX), y0 = cellOf(box.minY), x1 = cellOf(box.maxX), y1 = cellOf(box.maxY);
+            const bool oversized = (std::int64_t(x1) - x0 + 1) * (std::int64_t(y1) - y0 + 1) > MaxCells;
+            if (!proxy.handle.valid())
+                count++;
+            else if (x0 == proxy.x0 && y0 == proxy.y0 && x1 == proxy.x1 && y1 == proxy.y1) {
+                proxy.handle = handle;
+                proxy.box = box;
+                return true;
+            } else
+                unlink(id, proxy);
+            proxy.handle = handle;
+            proxy.box = box;
+            proxy.x0 = x0;
+            proxy.y0 = y0;
+            proxy.x1 = x1;
+            proxy.y1 = y1;
+            proxy.large = oversized;
+            link(id, proxy);
+            return true;
+        }
+
+        void remove(std::uint32_t id)
+        {
+            if (!live(id))
+                return ;
+            auto &proxy = proxies[id];
+            unlink(id, proxy);
+            proxy = Proxy{};
+            count--;
+        }
+
+        void clear()
+        {
+            proxies.clear();
+            cellIndex.clear();
+            cells.clear();
+            large.clear();
+            count = 0;
+        }
+
+        // Calls fun(EntityHandle) once for every box overlapping area. An area
+        // with a NaN or infinite bound overlaps nothing.
+        template <typename Fun>
+        void query(Aabb const &area, Fun &&fun) const
+        {
+            if (!finite(area))
+                return ;
+            if (++stamp == 0) {
+                for (auto &proxy: proxies)
+                    proxy.mark = 0;
+                stamp = 1;
+            }
+            auto visit = [&](Cell const &cell) {
+                for (auto id: cell.ids) {
+                    auto &proxy = proxies[id];
+                    if (proxy.mark == stamp)
+                        continue ;
+                    proxy.mark = stamp;
+                    if (proxy.box.overlaps(area))
+                        fun(proxy.handle);
+                }
+            };
+            const int x0 = cellOf(area.minX), y0 = cellOf(area.minY), x1 = cellOf(area.maxX), y1 = cellOf(area.maxY);
+            // Past as many cells as exist, walking them is cheaper.
+            if ((std::int64_t(x1) - x0 + 1) * (std::int64_t(y1) - y0 + 1) > std::int64_t(cells.size())) {
+                for (auto &cell: cells) {
+                    if (cell.x >= x0 && cell.x <= x1 && cell.y >= y0 && cell.y <= y1)
+                        visit(cell);
+                }
+            } else {
+                for (int x = x0; x <= x1; x++) {
+                    for (int y = y0; y <= y1; y++) {
+                        if (auto cell = findCell(x, y))
+                            visit(*cell);
+                    }
+                }
+            }
+            for (auto id: large) {
+                auto &proxy = proxies[id];
+                if (proxy.box.overlaps(area))
+                    fun(proxy.handle);
+            }
+        }
+
+        // Every pair of overlapping boxes, once, lowest entity id first,
+        // sorted. A pair sharing several cells is only tested in the cell
+        // holding the lower corner of their intersection.
+        void pairs(std::vector<std::pair<EntityHandle, EntityHandle>> &out) const
+        {
+            out.clear();
+            for (auto &cell: cells) {
+                auto const &ids = cell.ids;
+                for (std::size_t i = 0; i < ids.size(); i++) {
+                    auto &a = proxies[ids[i]];
+                    for (std::size_t j = i + 1; j < ids.size(); j++) {
+                        auto &b = proxies[ids[j]];
+                        if (std::max(a.x0, b.x0) != cell.x || std::max(a.y0, b.y0) != cell.y || !a.box.overlaps(b.box))
+                            continue ;
+                        if (ids[i] < ids[j])
+                            out.emplace_back(a.handle, b.handle);
+                        else
+                            out.emplace_back(b.handle, a.handle);
+                    }
+                }
+            }
+            // Large boxes against every other box, and each other once.
+            for (auto id: large) {
+                auto &a = proxies[id];
+                for (std::uint32_t other = 0; other < proxies.size(); other++) {
+                    auto &b = proxies[other];
+                    if (other == id || !b.handle.valid() || (b.large && other < id) || !a.box.overlaps(b.box))
+                        continue ;
+                    if (id < other)
+                        out.emplace_back(a.handle, b.handle);
+                    else
+                        out.emplace_back(b.handle, a.handle);
+                }
+            }
+            std::sort(out.begin(), out.end(), [](auto const &a, auto const &b) {
+                return a.first.index != b.first.index ? a.first.index < b.first.index : a.second.index < b.second.index;
+            });
+        }
+    };
+
+    // Built-in broadphase : keeps a SpatialGrid of every Bounds up to date
+    // from the Bounds attached, modified and detached since its last run, then
+    // posts the overlapping pairs to the events::Collision channel, read with
+    // EntityManager::read<events::Collision>() during the next frame.
+    class   Broadphase : public System
+    {
+        SpatialGrid grid;
+        bool built{false};
+        std::vector<std::pair<EntityHandle, EntityHandle>> overlapping;
+        std::vector<events::Collision> batch;
+    public:
+        explicit Broadphase(float cellSize = 1): grid(cellSize)
+        {
+            name = "Broadphase";
+        }
+
+        void run(float) override
+        {
+            // Removals forgotten while the broadphase was not running : rebuild.
+            if (built && !entityManager->removed<Bounds>([this](int id) { grid.remove(static_cast<std::uint32_t>(id)); }))
+                built = false;
+            if (!built) {
+                grid.clear();
+                entityManager->view<Bounds>().each([this](Entity &entity, Bounds const &bounds) {
+                    grid.update(entity.getHandle(), bounds.box);
+                });
+                built = true;
+            } else {
+                entityManager->changed<Bounds>([this](Entity &entity, Bounds const &bounds) {
+                    grid.update(entity.getHandle(), bounds.box);
+                });
+            }
+            grid.pairs(overlapping);
+            batch.clear();
+            for (auto &pair: overlapping)
+                batch.push_back({pair.first, pair.second});
+            entityManager->channel<events::Collision>().post(batch.begin(), batch.end());
+        }
+
+        SpatialGrid const &getGrid() const noexcept
+        {
+            return grid;
+        }
+    };
+}
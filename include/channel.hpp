@@ -0,0 +1,174 @@
+#pragma once
+
+# include <vector>
+# include <mutex>
+# include <cstdint>
+# include <utility>
+# include <type_traits>
+# include <unordered_map>
+# include "utils/types.hpp"
+
+namespace fengin
+{
+    // Gives every event type posted to a channel a small dense id, in order of
+    // first use. Keyed on futils::type_index so that plugins agree on the ids.
+    class   ChannelRegistry
+    {
+        std::mutex lock;
+        std::unordered_map<futils::type_index, std::uint32_t> ids;
+    public:
+        static ChannelRegistry &inst()
+        {
+            static ChannelRegistry registry;
+            return registry;
+        }
+
+        std::uint32_t idOf(futils::type_index index)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = ids.find(index);
+            if (it != ids.end())
+                return it->second;
+            const auto id = static_cast<std::uint32_t>(ids.size());
+            ids.emplace(index, id);
+            return id;
+        }
+    };
+
+    template <typename T>
+    struct  ChannelType
+    {
+        static std::uint32_t id()
+        {
+            static const std::uint32_t value = ChannelRegistry::inst().idOf(futils::type<T>::index);
+            return value;
+        }
+    };
+
+    // Read only view over the contiguous events of a channel.
+    template <typename T>
+    class   EventSpan
+    {
+        T const *first{nullptr};
+        std::size_t count{0};
+    public:
+        EventSpan() = default;
+        EventSpan(T const *first, std::size_t count): first(first), count(count) {}
+
+        T const *begin() const noexcept { return first; }
+        T const *end() const noexcept { return first + count; }
+        T const *data() const noexcept { return first; }
+        T const &operator[](std::size_t i) const noexcept { return first[i]; }
+        std::size_t size() const noexcept { return count; }
+        bool empty() const noexcept { return count == 0; }
+    };
+
+    class   IEventChannel
+    {
+    public:
+        virtual ~IEventChannel() {}
+        virtual void swap() noexcept = 0;
+        virtual void clear() noexcept = 0;
+        // Whether events posted before the last swap can be read.
+        virtual bool readable() const noexcept = 0;
+    };
+
+    // Double buffered queue of T. Events posted during a frame are appended to
+    // the back buffer ; swap() makes them readable as one contiguous span for
+    // the whole next frame, while the following ones accumulate. Buffers keep
+    // their capacity, so a steady flow of events stops allocating.
+    // Like sending an event, posting is only allowed from the main thread.
+    template <typename T>
+    class   EventChannel : public IEventChannel
+    {
+        std::vector<T> front;
+        std::vector<T> back;
+    public:
+        void post(T const &event) { back.push_back(event); }
+        void post(T &&event) { back.push_back(std::move(event)); }
+
+        // Aggregates such as events::Collision are brace initialized.
+        template <typename ...Args>
+        T &emplace(Args &&...args)
+        {
+            if constexpr (std::is_constructible<T, Args &&...>::value)
+                return back.emplace_back(std::forward<Args>(args)...);
+            else
+                return back.emplace_back(T{std::forward<Args>(args)...});
+        }
+
+        template <typename It>
+        void post(It first, It last)
+        {
+            back.insert(back.end(), first, last);
+        }
+
+        // Events posted before the last swap.
+        EventSpan<T> read() const noexcept
+        {
+            return EventSpan<T>(front.data(), front.size());
+        }
+
+        // Events posted since the last swap.
+        std::size_t pending() const noexcept
+        {
+            return back.size();
+        }
+
+        bool readable() const noexcept override
+        {
+            return !front.empty();
+        }
+
+        void swap() noexcept override
+        {
+            front.swap(back);
+            back.clear();
+        }
+
+        void clear() noexcept override
+        {
+            front.clear();
+            back.clear();
+        }
+    };
+
+    // Every event channel of an EntityManager, indexed by ChannelType id.
+    class   ChannelStore
+    {
+        std::vector<futils::UP<IEventChannel>> channels;
+    public:
+        template <typename T>
+        EventChannel<T> &channel()
+        {
+            const auto id = ChannelType<T>::id();
+            if (id >= channels.size())
+                channels.resize(id + 1);
+            if (!channels[id])
+                channels[id] = std::make_unique<EventChannel<T>>();
+            return static_cast<EventChannel<T> &>(*channels[id]);
+        }
+
+        template <typename T>
+        EventChannel<T> *find() const noexcept
+        {
+            const auto id = ChannelType<T>::id();
+            if (id >= channels.size())
+                return nullptr;
+            return static_cast<EventChannel<T> *>(channels[id].get());
+        }
+
+        bool readable(std::uint32_t id) const noexcept
+        {
+            return id < channels.size() && channels[id] && channels[id]->readable();
+        }
+
+        void swap() noexcept
+        {
+            for (auto &channel: channels) {
+                if (channel)
+                    channel->swap();
+            }
+        }
+    };
+}
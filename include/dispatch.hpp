@@ -0,0 +1,151 @@
+#pragma once
+
+# include <vector>
+# include <algorithm>
+# include <type_traits>
+# include "channel.hpp"
+
+namespace fengin
+{
+    // Bound handler : the object it is called on, and a plain function calling
+    // the right member. Two pointers, no allocation, one indirect call.
+    template <typename T>
+    struct  Delegate
+    {
+        void *instance{nullptr};
+        void (*call)(void *, T const &){nullptr};
+
+        void operator()(T const &event) const { call(instance, event); }
+    };
+
+    template <typename Method>
+    struct  MethodTraits;
+
+    template <typename C, typename T>
+    struct  MethodTraits<void (C::*)(T const &)>
+    {
+        using Class = C;
+        using Event = T;
+    };
+
+    template <typename C, typename T>
+    struct  MethodTraits<void (C::*)(T const &) noexcept> : MethodTraits<void (C::*)(T const &)> {};
+
+    class   ISignal
+    {
+    public:
+        virtual ~ISignal() {}
+        virtual void disconnect(void *instance) noexcept = 0;
+    };
+
+    // Handlers of T, called in connection order. Handlers may connect and
+    // disconnect while T is being sent : the ones connected meanwhile are
+    // only called from the next send.
+    template <typename T>
+    class   Signal : public ISignal
+    {
+        std::vector<Delegate<T>> handlers;
+        int sending{0};
+        bool holes{false};
+
+        void compact()
+        {
+            handlers.erase(std::remove_if(handlers.begin(), handlers.end(), [](auto const &handler) {
+                return handler.call == nullptr;
+            }), handlers.end());
+            holes = false;
+        }
+    public:
+        void connect(Delegate<T> delegate)
+        {
+            handlers.push_back(delegate);
+        }
+
+        template <auto Method, typename C>
+        void connect(C &instance)
+        {
+            connect({&instance, [](void *self, T const &event) {
+                (static_cast<C *>(self)->*Method)(event);
+            }});
+        }
+
+        template <void (*Fun)(T const &)>
+        void connect()
+        {
+            connect({nullptr, [](void *, T const &event) {
+                Fun(event);
+            }});
+        }
+
+        void disconnect(void *instance) noexcept override
+        {
+            for (auto &handler: handlers) {
+                if (handler.instance == instance) {
+                    handler.call = nullptr;
+                    holes = true;
+                }
+            }
+            if (holes && sending == 0)
+                compact();
+        }
+
+        void send(T const &event)
+        {
+            sending++;
+            const auto count = handlers.size();
+            try {
+                for (std::size_t i = 0; i < count; i++) {
+                    if (handlers[i].call != nullptr)
+                        handlers[i](event);
+                }
+            } catch (...) {
+                sending--;
+                throw ;
+            }
+            if (--sending == 0 && holes)
+                compact();
+        }
+
+        std::size_t size() const noexcept
+        {
+            return handlers.size();
+        }
+    };
+
+    // Typed, statically dispatched alternative to the Mediator : handlers take
+    // the event as T const & and are stored per event type in flat vectors of
+    // Delegate, so sending neither allocates nor copies the event.
+    // Like the Mediator, it is only used from the main thread.
+    class   Dispatcher
+    {
+        std::vector<futils::UP<ISignal>> signals;
+    public:
+        template <typename T>
+        Signal<T> &signal()
+        {
+            const auto id = ChannelType<T>::id();
+            if (id >= signals.size())
+                signals.resize(id + 1);
+            if (!signals[id])
+                signals[id] = std::make_unique<Signal<T>>();
+            return static_cast<Signal<T> &>(*signals[id]);
+        }
+
+        template <typename T>
+        void send(T const &event)
+        {
+            const auto id = ChannelType<T>::id();
+            if (id < signals.size() && signals[id])
+                static_cast<Signal<T> &>(*signals[id]).send(event);
+        }
+
+        // Removes every handler bound to instance.
+        void erase(void *instance) noexcept
+        {
+            for (auto &signal: signals) {
+                if (signal)
+                    signal->disconnect(instance);
+            }
+        }
+    };
+}
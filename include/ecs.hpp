@@ -5,16 +5,32 @@
 #pragma once
 
 # include <vector>
+# include <limits>
+# include <atomic>
 # include <list>
 # include <map>
 # include <queue>
 # include <typeinfo>
 # include <functional>
 # include <unordered_map>
+# include <unordered_set>
+# include <exception>
+# include <thread>
 # include "utils/dloader.hpp"
 # include "utils/clock.hpp"
 # include "utils/mediator.hpp"
 # include "utils/queue.hpp"
+# include "storage.hpp"
+# include "view.hpp"
+# include "threadpool.hpp"
+# include "pool.hpp"
+# include "handle.hpp"
+# include "log.hpp"
+# include "channel.hpp"
+# include "dispatch.hpp"
+# include "mpsc.hpp"
+# include "profiler.hpp"
+# include "snapshot.hpp"
 
 namespace fengin
 {
@@ -53,12 +69,30 @@ namespace fengin
         }
     };
 
+    // Components derive from Component, or are plain data : trivially copyable
+    // structs, stored as is. Only their storage knows their entity, see
+    // EntityManager::ownerOf.
+    template <typename T>
+    struct  IsComponent : std::bool_constant<std::is_base_of<Component, T>::value ||
+                                             (std::is_class<T>::value && std::is_trivially_copyable<T>::value)> {};
+
+    // Systems a frame runs : every one, or only those running at the fixed
+    // tick rate, or only those running once per rendered frame. See System::runPerFrame.
+    enum class RunPass
+    {
+        All,
+        Fixed,
+        Variable
+    };
+
     class   System
     {
+        friend class EntityManager;
     protected:
         std::string name{"Undefined"};
         EntityManager *entityManager{nullptr};
         EventManager *events{nullptr};
+        Dispatcher *dispatcher{nullptr};
         std::function<void()> afterBuild{[](){}};
         std::function<void(EntityManager *)> afterDeath{[](EntityManager *){}};
 
@@ -68,14 +102,123 @@ namespace fengin
         {
             events->require<T>(this, fun);
         }
+
+        // Typed alternative to addReaction : Handler is a member function of
+        // the system taking the event as T const &, called without any
+        // type erasure nor copy when T is emitted. Call it from afterBuild.
+        //     subscribe<&Physics::onCollision>();
+        template <auto Handler>
+        void subscribe()
+        {
+            using Traits = MethodTraits<decltype(Handler)>;
+            if (dispatcher == nullptr)
+                throw std::logic_error("Cannot subscribe before the system is added to an EntityManager");
+            // Bound to the System base, the one ~System and cleanSystems disconnect.
+            dispatcher->signal<typename Traits::Event>().connect({static_cast<System *>(this), [](void *self, typename Traits::Event const &event) {
+                (static_cast<typename Traits::Class *>(static_cast<System *>(self))->*Handler)(event);
+            }});
+        }
+
+        template <typename T>
+        void emit(T const &event)
+        {
+            dispatcher->send(event);
+        }
+
+        // Declaring the components a system touches lets the EntityManager run it
+        // alongside systems it does not conflict with. Such a system must not send
+        // events nor create, destroy, attach or detach directly, since it may run
+        // on a worker thread. Systems declaring nothing always run alone.
+        template <typename ...Ts>
+        void reads()
+        {
+            (readSet.set(ComponentType<Ts>::id()), ...);
+            declaredAccess = true;
+        }
+
+        template <typename ...Ts>
+        void writes()
+        {
+            (writeSet.set(ComponentType<Ts>::id()), ...);
+            declaredAccess = true;
+        }
+
+        // With a fixed tick rate, runs once per loop iteration with the real
+        // elapsed time instead of once per tick. Such a system typically
+        // renders, blending the last two ticks by EntityManager::getInterpolation().
+        void runPerFrame()
+        {
+            perFrame = true;
+        }
+
+        // Skips frames until seconds passed since the last run, elapsed then
+        // being the whole time since. A wakeup runs it earlier.
+        void runEvery(float seconds)
+        {
+            period = seconds;
+        }
+
+        // Sleeps until woken : by wake(), or by one of the wakeOn triggers.
+        void runWhenWoken()
+        {
+            period = std::numeric_limits<float>::infinity();
+        }
+
+        // Wakes the system when T is emitted through the Dispatcher, see
+        // subscribe. Call it from afterBuild.
+        template <typename T>
+        void wakeOn()
+        {
+            if (dispatcher == nullptr)
+                throw std::logic_error("Cannot wake on an event before the system is added to an EntityManager");
+            dispatcher->signal<T>().connect({static_cast<System *>(this), [](void *self, T const &) {
+                static_cast<System *>(self)->wake();
+            }});
+        }
+
+        // Wakes the system for the frame during which the events of T posted
+        // earlier can be read. See EntityManager::read.
+        template <typename T>
+        void wakeOnPost()
+        {
+            wakeChannels.push_back(ChannelType<T>::id());
+        }
+
+        // Wakes the system once one of Ts was attached, modified through
+        // Entity::modify or detached since its last run.
+        template <typename ...Ts>
+        void wakeOnChange()
+        {
+            (wakeComponents.push_back(ComponentType<Ts>::id()), ...);
+        }
+    private:
+        ComponentMask readSet;
+        ComponentMask writeSet;
+        bool declaredAccess{false};
+        // Change tick of the last run, or of its addition. See EntityManager::changed.
+        std::uint32_t lastRun{0};
+        bool perFrame{false};
+        // Given by the EntityManager, the same for every system of this name.
+        std::uint32_t id{0};
+        // Skipping frames, see runEvery and runWhenWoken.
+        float period{0};
+        float waited{0};    // Since the last run.
+        float credit{0};    // Toward the next run on schedule.
+        std::atomic<bool> awake{false};
+        std::vector<std::uint32_t> wakeChannels;
+        std::vector<ComponentId> wakeComponents;
     public:
         virtual ~System() {
             events->erase(this);
+            if (dispatcher != nullptr)
+                dispatcher->erase(this);
         }
         virtual void run(float elapsed = 0) = 0;
         void provideManager(EntityManager &manager) { entityManager = &manager; }
         void provideEventManager(EventManager &mediator) { events = &mediator; }
+        void provideDispatcher(Dispatcher &typed) { dispatcher = &typed; }
         std::string const &getName() const { return name; }
+        std::uint32_t getId() const noexcept { return id; }
         std::function<void(EntityManager *)> getAfterDeath()
         {
             return afterDeath;
@@ -84,6 +227,31 @@ namespace fengin
         {
             return afterBuild;
         }
+
+        bool conflictsWith(System const &other) const noexcept
+        {
+            if (!declaredAccess || !other.declaredAccess)
+                return true;
+            return (writeSet & (other.readSet | other.writeSet)).any() || (other.writeSet & readSet).any();
+        }
+
+        bool hasDeclaredAccess() const noexcept { return declaredAccess; }
+        std::uint32_t getLastRunTick() const noexcept { return lastRun; }
+        bool runsPerFrame() const noexcept { return perFrame; }
+
+        bool runsIn(RunPass pass) const noexcept
+        {
+            return pass == RunPass::All || (pass == RunPass::Variable) == perFrame;
+        }
+
+        // Runs the system during the next frame it belongs to, even if it
+        // sleeps or its period is not over. Thread safe.
+        void wake() noexcept
+        {
+            awake.store(true, std::memory_order_release);
+        }
+
+        bool skipsFrames() const noexcept { return period > 0; }
     };
 
     class StateSystem : public System
@@ -99,13 +267,15 @@ namespace fengin
     class ComponentAttached
     {
         void verifType() {
-            static_assert(std::is_base_of<Component, T>::value,
+            static_assert(IsComponent<T>::value,
                           "Cannot emit event ComponentAttached with non Component Type");
         }
     public:
         T const &compo;
+        Entity const *entity{nullptr};  // Plain data components cannot tell it.
         ComponentAttached(T &&compo): compo(std::forward<T>(compo)) { verifType(); }
         ComponentAttached(T const &compo): compo(compo) { verifType(); }
+        ComponentAttached(T const &compo, Entity const &entity): compo(compo), entity(&entity) { verifType(); }
     };
 
     // Event
@@ -113,33 +283,68 @@ namespace fengin
     class ComponentDeleted
     {
         void verifType() {
-            static_assert(std::is_base_of<Component, T>::value,
-                          "Cannot emit event ComponentAttached with non Component Type");
+            static_assert(IsComponent<T>::value,
+                          "Cannot emit event ComponentDeleted with non Component Type");
         }
     public:
         T const &compo;
+        Entity const *entity{nullptr};  // Plain data components cannot tell it.
         ComponentDeleted(T &&compo): compo(std::forward<T>(compo)) { verifType(); }
         ComponentDeleted(T const &compo): compo(compo) { verifType(); }
+        ComponentDeleted(T const &compo, Entity const &entity): compo(compo), entity(&entity) { verifType(); }
+    };
+
+    // Set by the EntityManager while it constructs an entity, so that components
+    // attached from the entity's constructor go straight to the manager's storage.
+    struct  EntityContext
+    {
+        ComponentStore *store{nullptr};
+        int id{0};
+        std::uint32_t generation{0};
+
+        static EntityContext &current()
+        {
+            static thread_local EntityContext context;
+            return context;
+        }
     };
 
     class   Entity
     {
+        friend class EntityManager;
+
         int _id;
+        std::uint32_t _generation{0};
         futils::type_index concreteType;
-        std::unordered_map<futils::type_index, Component *>    components;
+        std::uint32_t typeSlot{0};  // Index in the EntityManager's list of its concrete type.
+        ComponentStore *store{nullptr};
+        ComponentMask mask;
+
+        // Who destroys it : nobody before the end of the frame (transient), its
+        // creator system on demand (saved), or also that system's shutdown (temporary).
+        enum class Ownership : std::uint8_t
+        {
+            None,
+            Saved,
+            Temporary
+        };
+        Ownership ownership{Ownership::None};
+        std::uint32_t owner{0};     // Id of the creator system.
+        // Neighbours in the list of temporary entities of the owner.
+        Entity *previousOwned{nullptr};
+        Entity *nextOwned{nullptr};
 
         template                            <typename Compo>
         void                                verifIsComponent()
         {
-            if (!std::is_base_of<Component, Compo>::value)
+            if (!IsComponent<Compo>::value)
                 throw std::logic_error(std::string(typeid(Compo).name()) + " is not a Component");
         }
     public:
         // TODO: SHOULD BE PRIVATE AND FRIEND WITH ENTITY MANAGER
         std::function<bool(Component &)> onExtension{[](Component &){return false;}};
-        std::function<void(Component &)> onDetach{[](Component &){return false;}};
         std::function<void()> afterBuild{[](){}};
-        std::queue<std::pair<Component *, std::function<void()>>> lateinitComponents;
+        std::queue<std::function<void()>> lateinitComponents;
         futils::Mediator *events{nullptr};
         EntityManager *entityManager{nullptr};
         void setConcreteType(futils::type_index t)
@@ -154,8 +359,18 @@ namespace fengin
             return concreteType;
         }
 
+        ComponentMask const &getComponentMask() const noexcept {
+            return mask;
+        }
+
         Entity() {
-            this->_id = futils::UID::get();
+            auto &context = EntityContext::current();
+            if (context.store != nullptr) {
+                this->_id = context.id;
+                this->_generation = context.generation;
+                this->store = context.store;
+            } else
+                this->_id = futils::UID::get();
         }
         virtual ~Entity() {}
 
@@ -163,58 +378,118 @@ namespace fengin
         Compo       &attach(Args ...args)
         {
             verifIsComponent<Compo>();
-            if (components.find(futils::type<Compo>::index) != components.end())
+            if (store == nullptr)
+                throw std::logic_error(std::string("Cannot attach ") + typeid(Compo).name() + " to an entity not created by an EntityManager");
+            const auto id = ComponentType<Compo>::id();
+            if (mask.test(id))
                 throw std::runtime_error(std::string("Cannot have same component twice (") + typeid(Compo).name() + ")!");
-            auto compo = new Compo(args...);
-            compo->setTypeindex(futils::type<Compo>::index);
-            compo->setEntity(*this);
-            this->components.insert(std::pair<futils::type_index, Component *>(compo->getTypeindex(), compo));
-            if (onExtension(*compo) == false) {
-                lateinitComponents.push(std::pair<Compo *, std::function<void()>>(compo, [this, compo](){
-                    events->send<ComponentAttached<Compo>>(*compo);
-                }));
+            auto &compo = store->storage<Compo>().emplace(_id, *this, std::move(args)...);
+            mask.set(id);
+            bool built;
+            if constexpr (std::is_base_of<Component, Compo>::value) {
+                compo.setTypeindex(futils::type<Compo>::index);
+                compo.setEntity(*this);
+                built = onExtension(compo);
             } else
-                events->send<ComponentAttached<Compo>>(*compo);
-            return *compo;
+                built = entityManager != nullptr;
+            if (built == false) {
+                // Components move inside their storage: look it up again when notifying.
+                lateinitComponents.push([this](){
+                    if (has<Compo>())
+                        events->send<ComponentAttached<Compo>>(get<Compo>(), *this);
+                });
+            } else
+                events->send<ComponentAttached<Compo>>(compo, *this);
+            return compo;
         };
 
         template <typename T>
-        bool has()
+        bool has() const
         {
-            static_assert(std::is_base_of<Component, T>::value, "Error : T is not a Component in entity->has<T>()");
-            for (const auto &it: components)
-            {
-                if (it.first == futils::type<T>::index)
-                    return true;
-            }
-            return false;
+            static_assert(IsComponent<T>::value, "Error : T is not a Component in entity->has<T>()");
+            return mask.test(ComponentType<T>::id());
         }
 
         template <typename T>
         T &get() const
         {
-            for (auto &it: components)
-            {
-                if (it.first == futils::type<T>::index)
-                    return static_cast<T &>(*it.second);
-            }
+            if (has<T>())
+                return *store->find<T>(_id);
             throw std::runtime_error("Entity " + std::to_string(this->getId()) + "  does not have requested component : " + std::string(typeid(T).name()));
         };
 
+        // Same as get, flagging the component as modified for change queries.
+        // Writing through get<T>() is not seen by EntityManager::changed.
+        template <typename T>
+        T &modify()
+        {
+            auto &compo = get<T>();
+            store->find<T>()->touch(_id);
+            return compo;
+        }
+
+        // Refers to this entity's Compo even after the storage moves it.
+        template <typename Compo>
+        ComponentHandle<Compo> handle() const
+        {
+            if (!has<Compo>())
+                throw std::runtime_error("Entity " + std::to_string(this->getId()) + "  does not have requested component : " + std::string(typeid(Compo).name()));
+            return ComponentHandle<Compo>(*store->find<Compo>(), getHandle());
+        }
+
         template <typename Compo>
         bool detach()
         {
-            if (components.find(futils::type<Compo>::index) == components.end())
+            if (!has<Compo>())
                 return false;
-            auto compo = components.at(futils::type<Compo>::index);
-            events->send<ComponentDeleted<Compo>>(static_cast<const Compo &>(*compo));
-            components.erase(futils::type<Compo>::index);
-            onDetach(*compo);
-            delete compo;
+            auto &storage = *store->find<Compo>();
+            events->send<ComponentDeleted<Compo>>(static_cast<const Compo &>(storage.get(_id)), *this);
+            storage.remove(_id);
+            mask.reset(ComponentType<Compo>::id());
             return true;
         }
 
         int         getId() const { return this->_id; }
+        EntityHandle getHandle() const { return {static_cast<std::uint32_t>(this->_id), this->_generation}; }
+    };
+
+    template <typename T>
+    T *ComponentHandle<T>::get() const noexcept
+    {
+        if (storage == nullptr)
+            return nullptr;
+        auto owner = storage->entityOf(getEntityId());
+        return owner != nullptr && owner->getHandle() == entity ? storage->find(getEntityId()) : nullptr;
+    }
+
+    // Every entity of concrete type T, as T &, in no particular order.
+    // Creating or destroying a T invalidates it. See EntityManager::entitiesOf.
+    template <typename T>
+    class   EntityRange
+    {
+        Entity *const *first{nullptr};
+        std::size_t count{0};
+    public:
+        class   iterator
+        {
+            Entity *const *it;
+        public:
+            explicit iterator(Entity *const *it): it(it) {}
+            T &operator*() const { return static_cast<T &>(**it); }
+            T *operator->() const { return static_cast<T *>(*it); }
+            iterator &operator++() { it++; return *this; }
+            bool operator==(iterator const &other) const { return it == other.it; }
+            bool operator!=(iterator const &other) const { return it != other.it; }
+        };
+
+        EntityRange() = default;
+        EntityRange(Entity *const *first, std::size_t count): first(first), count(count) {}
+
+        iterator begin() const noexcept { return iterator(first); }
+        iterator end() const noexcept { return iterator(first + count); }
+        T &operator[](std::size_t i) const noexcept { return static_cast<T &>(*first[i]); }
+        std::size_t size() const noexcept { return count; }
+        bool empty() const noexcept { return count == 0; }
     };
 
     // Event
@@ -241,19 +516,36 @@ namespace fengin
         std::string sysName{""};
     };
 
+    class   CommandBuffer;
+
     class   EntityManager
     {
-        unsigned int idCount{0};
-        using SystemMap = std::unordered_map<std::string, System *>;
+        friend class CommandBuffer;
+        friend class SnapshotRegistry;
+
         using SystemQueue = futils::Queue<std::string>;
-        using ComponentContainer = std::unordered_multimap<futils::type_index, Component *>;
+        using ComponentContainer = ComponentStore;
         using DynamicLibaryContainer = std::unordered_map<std::string, futils::UP<futils::Dloader>>;
         int status{0};
         int orderIndex{0};
 
-        SystemMap systemsMap;
+        // Systems by id. A name keeps its id once its system is removed, so
+        // that a system loaded again under it, or the entities of a snapshot
+        // naming it as creator, find the same record.
+        struct  SystemRecord
+        {
+            std::string name;
+            System *system{nullptr};
+            Entity *temporaries{nullptr};   // Linked through Entity::nextOwned.
+        };
+        std::vector<SystemRecord> systemRecords;
+        std::unordered_map<std::string, std::uint32_t> systemIds;
         SystemQueue systemsMarkedForErase;
-        ComponentContainer components;
+        // Bumped before each system runs and at frame boundaries, it also tells
+        // which system each thread runs. See ChangeClock.
+        ChangeClock clock;
+        ComponentContainer components{&clock};
+        std::uint32_t lastTickCheck{0};
 
         // Containers for system ordering.
         std::map<int, System *> orderMap;
@@ -261,18 +553,82 @@ namespace fengin
 
         // All entities
         int counter{0};
+        std::uint64_t entitiesCreated{0};
+        std::uint64_t eventsSent{0};
+
+        // Opt-in frame profiling, see enableProfiling.
+        struct  ProfileTotals
+        {
+            std::uint64_t created;
+            std::uint64_t destroyed;
+            std::uint64_t attached;
+            std::uint64_t detached;
+            std::uint64_t events;
+            std::uint64_t allocations;
+        };
+        futils::UP<Profiler> profiler;
+        std::vector<std::uint32_t> profileNames;
+        ProfileTotals profileBase{};
+        // Profiling enabled or disabled during a frame starts with the next one.
+        bool inFrame{false};
+        bool profilerPending{false};
+        futils::UP<Profiler> nextProfiler;
 
         // Time
         futils::Clock<float> timeKeeper;
 
+        // Parallel scheduling : systems in registration order, each one waiting
+        // for the earlier systems it conflicts with.
+        struct  ScheduledSystem
+        {
+            System *system;
+            std::vector<std::size_t> successors;
+            int dependencies{0};
+        };
+        futils::UP<ThreadPool> ownPool;
+        ThreadPool *pool{nullptr};
+        std::vector<ScheduledSystem> schedule;
+        futils::UP<std::atomic<int>[]> remaining;
+        bool scheduleDirty{true};
+        bool parallelSystems{false};
+        bool perFrameSystems{false};
+        RunPass pass{RunPass::All};
+        float interpolation{0};
+
         // Event Mediator
         futils::Mediator *events{nullptr};
+        // Batched events, swapped at the start of every frame, or of every tick
+        // under the fixed timestep loop.
+        ChannelStore channels;
+        // Typed events, see System::subscribe.
+        Dispatcher dispatcher;
+        // Events posted from other threads, delivered at the start of a frame.
+        EventQueue mailbox;
 
-        // Used for memory Management to track entities created
-        System *currentSystem{nullptr};
-        std::unordered_multimap<std::string, Entity *> temporaryEntities;
-        std::unordered_map<Entity *, std::string> temporaryEntitiesRecords;
-        std::unordered_map<Entity *, std::string> savedEntities;
+        // Entity memory : one pool per concrete type, and an arena for the
+        // transient entities of the current frame.
+        std::unordered_map<futils::type_index, futils::UP<BlockPool>> entityPools;
+        // Live entities of each concrete type, transient ones included.
+        std::unordered_map<futils::type_index, std::vector<Entity *>> entitiesByType;
+        FrameArena frameArena;
+        std::vector<Entity *> transientEntities;
+
+        // Deferred structural changes, one buffer per thread recording them.
+        static inline std::atomic<unsigned int> instances{0};
+        const unsigned int serial{++instances};
+        std::mutex commandsLock;
+        std::unordered_map<std::thread::id, std::shared_ptr<CommandBuffer>> commandBuffers;
+
+        // Entity slots, indexed by entity id. Handles resolve through them and
+        // freed ids are reused first, keeping ids dense.
+        struct  EntitySlot
+        {
+            Entity *entity{nullptr};
+            std::uint32_t generation{0};
+            std::uint32_t nextFree{EntityHandle::Invalid};
+        };
+        std::vector<EntitySlot> slots;
+        std::uint32_t freeSlots{EntityHandle::Invalid};
 
         // Extensions (System)
         DynamicLibaryContainer extensions;
@@ -286,228 +642,948 @@ namespace fengin
                 throw std::logic_error(std::string(typeid(T).name()) + " is not an Entity");
         }
 
+        EntityHandle acquireSlot()
+        {
+            if (freeSlots == EntityHandle::Invalid) {
+                slots.emplace_back();
+                return {static_cast<std::uint32_t>(slots.size() - 1), 0};
+            }
+            const auto index = freeSlots;
+            freeSlots = slots[index].nextFree;
+            return {index, slots[index].generation};
+        }
+
+        void releaseSlot(std::uint32_t index)
+        {
+            auto &slot = slots[index];
+            slot.entity = nullptr;
+            slot.generation++;
+            slot.nextFree = freeSlots;
+            freeSlots = index;
+        }
+
         template <typename T>
-        void initEntity(T &entity)
+        BlockPool &poolOf()
         {
-            entity.setId(idCount++);
-            entity.setConcreteType(futils::type<T>::index);
-            entity.events = events;
-            entity.entityManager = this;
-            entity.onExtension = [this](Component &compo) {
-                components.insert(std::pair<futils::type_index, Component *>
-                                          (compo.getTypeindex(), &compo));
+            auto &pool = entityPools[futils::type<T>::index];
+            if (!pool)
+                pool = std::make_unique<BlockPool>(sizeof(T), alignof(T));
+            return *pool;
+        }
+
+        // Builds T in memory with the context set, so that the components it
+        // attaches in its constructor are stored under its final id.
+        template <typename T, typename ...Args>
+        T *constructAt(void *memory, EntityHandle handle, ComponentStore &store, Args ...args)
+        {
+            auto &context = EntityContext::current();
+            const auto saved = context;
+            context.store = &store;
+            context.id = static_cast<int>(handle.index);
+            context.generation = handle.generation;
+            T *entity = nullptr;
+            try {
+                entity = new (memory) T(args...);
+            } catch (...) {
+                store.removeAll(handle.index);
+                context = saved;
+                throw ;
+            }
+            context = saved;
+            slots[handle.index].entity = entity;
+            return entity;
+        }
+
+        template <typename T, typename ...Args>
+        T *construct(void *memory, Args ...args)
+        {
+            const auto handle = acquireSlot();
+            try {
+                return constructAt<T>(memory, handle, components, args...);
+            } catch (...) {
+                releaseSlot(handle.index);
+                throw ;
+            }
+        }
+
+        // Builds a default T under handle for loadSnapshot. What its constructor
+        // attaches goes to scratch, since the snapshot's columns replace it.
+        // No event is sent and afterBuild is not called.
+        template <typename T>
+        Entity *restoreEntity(EntityHandle handle, ComponentStore &scratch)
+        {
+            auto &pool = poolOf<T>();
+            auto memory = pool.allocate();
+            T *entity = nullptr;
+            try {
+                entity = constructAt<T>(memory, handle, scratch);
+            } catch (...) {
+                pool.deallocate(memory);
+                throw ;
+            }
+            entity->store = &components;
+            entity->mask.reset();
+            entity->lateinitComponents = {};
+            entity->setConcreteType(futils::type<T>::index);
+            track(*entity);
+            entity->events = events;
+            entity->entityManager = this;
+            entity->onExtension = [](Component &) {
                 return true;
             };
-            entity.onDetach = [this](Component &compo) {
-                auto range = components.equal_range(compo.getTypeindex());
-                std::vector<std::pair<futils::type_index, Component *>> save;
-                int count = 0;
-                for (auto it = range.first; it != range.second; it++) {
-                    count++;
-                    auto &pair = *it;
-                    auto tmp = pair.second;
-                    if (tmp != &compo)
-                        save.push_back(pair);
-                }
-                components.erase(compo.getTypeindex());
-                for (auto savedPair: save)
-                {
-                    components.insert(savedPair);
-                }
-            };
-            events->send<EntityCreated<T>>(entity);
-            while (!entity.lateinitComponents.empty()) {
-                auto front = entity.lateinitComponents.front();
-                entity.onExtension(*front.first);
-                front.second(); // Notification
-                entity.lateinitComponents.pop();
-            }
-            entity.afterBuild();
-            counter++;
-            std::cout << this << ": Created " << typeid(T).name() << " with id " << entity.getId() << std::endl;
+            return entity;
         }
 
-        bool destroyFromSaved(Entity &entity)
+        // Destroys every entity at once, without events, for loadSnapshot.
+        void releaseAll()
         {
-            auto &container = savedEntities;
-            if (container.find(&entity) == container.end())
-                return false;
-            std::cout << currentSystem->getName() << ": Destroyed saved entity " << entity.getId() << " created by " << container[&entity] << std::endl;
-            container.erase(&entity);
-            delete &entity;
-            counter--;
-            return true;
+            for (auto &slot: slots) {
+                if (slot.entity != nullptr)
+                    release(*slot.entity);
+            }
+            for (auto &record: systemRecords)
+                record.temporaries = nullptr;
+            counter = 0;
         }
 
-        bool destroyFromTemporary(Entity &entity)
+        template <typename T, typename ...Args>
+        T *construct(Args ...args)
         {
-            if (temporaryEntitiesRecords.find(&entity) == temporaryEntitiesRecords.end())
-                return false;
-            const auto &system = currentSystem->getName();
-            const auto &creatorSystem = temporaryEntitiesRecords[&entity];
-            auto range = temporaryEntities.equal_range(creatorSystem);
-            for (auto it = range.first; it != range.second; it++) {
-                if (it->second == &entity)
-                {
-                    temporaryEntities.erase(it);
-                    break ;
-                }
+            auto &pool = poolOf<T>();
+            auto memory = pool.allocate();
+            try {
+                return construct<T>(memory, args...);
+            } catch (...) {
+                pool.deallocate(memory);
+                throw ;
             }
-            std::cerr << system << ": Destroyed temporary entity " << entity.getId() << " created by " << creatorSystem << std::endl;
-            temporaryEntitiesRecords.erase(&entity);
-            delete &entity;
-            counter--;
-            return true;
         }
 
-        void initSystem(System &system)
+        void track(Entity &entity)
         {
-            // TODO : Smart Pointer !!
-            system.provideManager(*this);
-            system.provideEventManager(*events);
-            auto afterBuild = system.getAfterBuild();
-            auto *save = currentSystem;
-            currentSystem = &system;
-            afterBuild();
-            currentSystem = save;
-            events->send<std::string>("[" + system.getName() + "] loaded.");
-            this->systemsMap.insert(std::pair<std::string, System *>(system.getName(), &system));
-            orderMap[orderIndex] = &system;
-            systemOrder[&system] = orderIndex;
-            orderIndex++;
+            auto &list = entitiesByType[entity.getConcreteType()];
+            entity.typeSlot = static_cast<std::uint32_t>(list.size());
+            list.push_back(&entity);
         }
-    public:
-        EntityManager() {
-            timeKeeper.start();
+
+        void untrack(Entity &entity)
+        {
+            auto &list = entitiesByType[entity.getConcreteType()];
+            auto last = list.back();
+            list[entity.typeSlot] = last;
+            last->typeSlot = entity.typeSlot;
+            list.pop_back();
         }
 
-        template    <typename T, typename ...Args>
-        T &smartCreate(Args ...args)
+        std::uint32_t systemIdOf(std::string const &name)
         {
-            verifIsEntity<T>();
-            auto entity = new T(args...);
-            initEntity(*entity);
-            const auto &name = currentSystem->getName();
-            temporaryEntities.insert(std::pair<std::string, Entity *>(name, entity));
-            temporaryEntitiesRecords[entity] = name;
-            std::cout << "[" << name << "] created " << typeid(T).name() << " with id " << entity->getId() << std::endl;
-            return *entity;
+            auto it = systemIds.find(name);
+            if (it != systemIds.end())
+                return it->second;
+            const auto id = static_cast<std::uint32_t>(systemRecords.size());
+            systemRecords.push_back({name});
+            systemIds.emplace(name, id);
+            return id;
         }
 
-        template <typename T, typename ...Args>
-        T &create(Args ...args)
+        // Entities belong to the system creating them : the one of this manager
+        // the calling thread runs.
+        template <typename T>
+        System &creator() const
         {
-            verifIsEntity<T>();
-            auto entity = new T(args...);
-            initEntity(*entity);
-            savedEntities.insert(std::pair<Entity *, std::string>(entity, currentSystem->getName()));
-            return *entity;
-        };
+            auto system = clock.system();
+            if (system == nullptr)
+                throw std::logic_error(std::string("Cannot create ") + typeid(T).name() + " outside of the systems of its EntityManager");
+            return *system;
+        }
 
-        bool destroy(Entity &entity)
+        void own(Entity &entity, std::uint32_t owner, bool temporary)
         {
-            if (!destroyFromSaved(entity))
-                return destroyFromTemporary(entity);
-            return true;
+            entity.owner = owner;
+            if (!temporary) {
+                entity.ownership = Entity::Ownership::Saved;
+                return ;
+            }
+            entity.ownership = Entity::Ownership::Temporary;
+            auto &record = systemRecords[owner];
+            entity.previousOwned = nullptr;
+            entity.nextOwned = record.temporaries;
+            if (record.temporaries != nullptr)
+                record.temporaries->previousOwned = &entity;
+            record.temporaries = &entity;
         }
 
-        template    <typename System, typename ...Args>
-        void addSystem(Args ...args)
+        void disown(Entity &entity)
         {
-            if (!std::is_base_of<System, System>::value)
-                throw std::logic_error(std::string(typeid(System).name()) + " is not a System");
-            auto system = new System(args...);
-            if (systemsMap.find(system->getName()) == systemsMap.end())
-                initSystem(*system);
-            else
-                events->send<std::string>("[" + system->getName() + "] already loaded.");
+            if (entity.ownership == Entity::Ownership::Temporary) {
+                if (entity.previousOwned != nullptr)
+                    entity.previousOwned->nextOwned = entity.nextOwned;
+                else
+                    systemRecords[entity.owner].temporaries = entity.nextOwned;
+                if (entity.nextOwned != nullptr)
+                    entity.nextOwned->previousOwned = entity.previousOwned;
+            }
+            entity.ownership = Entity::Ownership::None;
+        }
+
+        void release(Entity &entity)
+        {
+            untrack(entity);
+            components.removeAll(entity.getId(), entity.getComponentMask());
+            // The pool hands out blocks for the most derived type.
+            releaseSlot(entity.getId());
+            auto memory = dynamic_cast<void *>(&entity);
+            auto &pool = *entityPools.at(entity.getConcreteType());
+            entity.~Entity();
+            pool.deallocate(memory);
+        }
+
+        void releaseTransients()
+        {
+            for (auto entity: transientEntities) {
+                untrack(*entity);
+                components.removeAll(entity->getId(), entity->getComponentMask());
+                releaseSlot(entity->getId());
+                entity->~Entity();
+            }
+            counter -= static_cast<int>(transientEntities.size());
+            transientEntities.clear();
+            frameArena.reset();
+        }
+
+        template <typename T>
+        void initEntity(T &entity)
+        {
+            entity.setConcreteType(futils::type<T>::index);
+            track(entity);
+            entity.events = events;
+            entity.entityManager = this;
+            entity.onExtension = [](Component &) {
+                return true;
+            };
+            events->send<EntityCreated<T>>(entity);
+            while (!entity.lateinitComponents.empty()) {
+                entity.lateinitComponents.front()(); // Notification
+                entity.lateinitComponents.pop();
+            }
+            entity.afterBuild();
+            counter++;
+            entitiesCreated++;
+            FENGIN_DEBUG(static_cast<void const *>(this), ": Created ", typeid(T).name(), " with id ", entity.getId());
         }
 
         template <typename ...Args>
-        LoadStatus loadSystem(std::string const &path, Args ...args)
+        LoadStatus installSystem(std::string const &path, futils::UP<futils::Dloader> library, Args ...args)
         {
             LoadStatus ret;
-            if (extensions.find(path) != extensions.end()) {
-                std::cerr << path << " already loaded." << std::endl;
+            extensions[path] = std::move(library);
+            auto system = extensions[path]->build<System>(args...);
+            if (hasSystem(system->getName())) {
+                // Like addSystem : a second system of the same name is dropped.
+                FENGIN_WARNING("[", system->getName(), "] already loaded, ignoring ", path);
+                system->provideEventManager(*events);
+                delete system;
+                extensions.erase(path);
                 return ret;
             }
-            extensions[path] = std::make_unique<futils::Dloader>(futils::Dloader(path));
-            auto system = extensions[path]->build<System>(args...);
-            std::cout << "System " << system->getName() << " loaded from path " << path << std::endl;
+            FENGIN_INFO("System ", system->getName(), " loaded from path ", path);
             initSystem(*system);
             ret.loaded = true;
             ret.sysName = system->getName();
             extensionFiles[ret.sysName] = path;
             return ret;
-        };
+        }
 
-        void removeSystem(std::string const &systemName)
+        void initSystem(System &system)
         {
-            if (systemsMarkedForErase.find(systemName))
-                return ;
-            systemsMarkedForErase.push(systemName);
+            // TODO : Smart Pointer !!
+            system.provideManager(*this);
+            system.provideEventManager(*events);
+            system.provideDispatcher(dispatcher);
+            system.id = systemIdOf(system.getName());
+            systemRecords[system.id].system = &system;
+            auto afterBuild = system.getAfterBuild();
+            {
+                // What changed before the system was added is not new to it,
+                // what it builds is : see EntityManager::changed.
+                system.lastRun = clock.latest();
+                ChangeClock::Scope building(clock, &system, clock.next());
+                afterBuild();
+            }
+            FENGIN_INFO("[", system.getName(), "] loaded.");
+            orderMap[orderIndex] = &system;
+            systemOrder[&system] = orderIndex;
+            orderIndex++;
+            scheduleDirty = true;
         }
 
-        template <typename T>
-        std::vector<T *> get()
+        void buildSchedule()
         {
-            static_assert(std::is_base_of<Component, T>::value, "Error : T is not a Component");
-            std::vector<T *> res;
-            try {
-                auto range = components.equal_range(futils::type<T>::index);
-                if (range.first == range.second) {
-                    return {};
-                }
-                for (auto it = range.first; it != range.second; it++) {
-                    res.push_back(static_cast<T *>(it->second));
+            schedule.clear();
+            parallelSystems = false;
+            perFrameSystems = false;
+            for (auto &pair: orderMap) {
+                schedule.push_back({pair.second, {}, 0});
+                parallelSystems = parallelSystems || pair.second->hasDeclaredAccess();
+                perFrameSystems = perFrameSystems || pair.second->runsPerFrame();
+            }
+            for (std::size_t i = 0; i < schedule.size(); i++) {
+                for (std::size_t j = 0; j < i; j++) {
+                    if (schedule[j].system->conflictsWith(*schedule[i].system)) {
+                        schedule[j].successors.push_back(i);
+                        schedule[i].dependencies++;
+                    }
                 }
-            } catch (std::exception const &e) {
-                std::cerr << e.what() << std::endl;
             }
-            return res;
-        };
-
-        void provideEventManager(EventManager &mediator) {
-            events = &mediator;
+            remaining.reset(new std::atomic<int>[schedule.size()]);
+            profileNames.clear();
+            if (profiler) {
+                for (auto &scheduled: schedule)
+                    profileNames.push_back(profiler->nameId(scheduled.system->getName()));
+            }
+            scheduleDirty = false;
         }
 
-        bool        isFine() const
+        std::uint32_t nextTick() noexcept
         {
-            return this->status == 0;
+            return clock.next();
         }
 
-        int getNumberOfSystems() const
+        // Whether a system skipping frames runs in this one, elapsed after the
+        // last frame it could have run in. Its elapsed time becomes the time since its last run.
+        bool isDue(System &system, float &elapsed)
         {
-            return systemsMap.size();
+            system.waited += elapsed;
+            system.credit += elapsed;
+            bool woken = system.awake.exchange(false, std::memory_order_acq_rel);
+            for (std::size_t i = 0; !woken && i < system.wakeChannels.size(); i++)
+                woken = channels.readable(system.wakeChannels[i]);
+            for (std::size_t i = 0; !woken && i < system.wakeComponents.size(); i++) {
+                auto storage = components.find(system.wakeComponents[i]);
+                woken = storage != nullptr && ChangeTick::newer(storage->lastChange(), system.lastRun);
+            }
+            if (!woken && system.credit < system.period)
+                return false;
+            // On schedule, keep the phase. Woken, or late by a whole period, start over.
+            if (system.credit >= system.period && system.credit < 2 * system.period)
+                system.credit -= system.period;
+            else
+                system.credit = 0;
+            elapsed = system.waited;
+            system.waited = 0;
+            return true;
         }
 
-        void cleanSystems()
+        void runSystem(System &system, float elapsed)
+        {
+            const auto tick = nextTick();
+            ChangeClock::Scope running(clock, &system, tick);
+            system.run(elapsed);
+            system.lastRun = tick;
+        }
+
+        // Runs the system at index in the schedule if it belongs to this pass.
+        void runScheduled(std::size_t index, float elapsed)
+        {
+            auto &system = *schedule[index].system;
+            if (!system.runsIn(pass) || (system.skipsFrames() && !isDue(system, elapsed)))
+                return ;
+            if (!profiler) {
+                runSystem(system, elapsed);
+                return ;
+            }
+            const auto start = profiler->now();
+            runSystem(system, elapsed);
+            profiler->record(index, profileNames[index], start);
+        }
+
+        ProfileTotals profileTotals() const noexcept
+        {
+            return {entitiesCreated, entitiesCreated - counter, components.attachments(), components.detachments(),
+                    eventsSent, MemoryStats::allocations().load(std::memory_order_relaxed)};
+        }
+
+        void beginProfile()
+        {
+            profiler->beginFrame(schedule.size());
+            profileBase = profileTotals();
+        }
+
+        void endProfile()
+        {
+            auto &frame = *profiler->frame();
+            const auto totals = profileTotals();
+            frame.entitiesCreated = totals.created - profileBase.created;
+            frame.entitiesDestroyed = totals.destroyed - profileBase.destroyed;
+            frame.componentsAttached = totals.attached - profileBase.attached;
+            frame.componentsDetached = totals.detached - profileBase.detached;
+            frame.eventsSent = totals.events - profileBase.events;
+            frame.allocations = totals.allocations - profileBase.allocations;
+            profiler->endFrame();
+        }
+
+        // Runs a step of the frame, timed under name when profiling.
+        template <typename Fun>
+        void profileStep(char const *name, Fun &&fun)
+        {
+            if (!profiler) {
+                fun();
+                return ;
+            }
+            const auto start = profiler->now();
+            fun();
+            profiler->record(profiler->nameId(name), start);
+        }
+
+        void applyProfiling()
+        {
+            if (!profilerPending)
+                return ;
+            profiler = std::move(nextProfiler);
+            profilerPending = false;
+            scheduleDirty = true;
+        }
+
+        void finishFrame()
+        {
+            inFrame = false;
+            applyProfiling();
+        }
+
+        // Removals older than every system's last run can no longer be asked for.
+        void pruneRemovals()
+        {
+            if (orderMap.empty())
+                return ;
+            auto oldest = clock.latest();
+            for (auto &pair: orderMap) {
+                if (ChangeTick::newer(oldest, pair.second->lastRun))
+                    oldest = pair.second->lastRun;
+            }
+            components.pruneRemovals(oldest);
+        }
+
+        // Ticks compare wrapping around : every ChangeTick::CheckInterval ticks,
+        // the stored ones too far behind are brought closer.
+        void checkTicks()
+        {
+            const auto now = clock.latest();
+            if (now - lastTickCheck < ChangeTick::CheckInterval)
+                return ;
+            lastTickCheck = now;
+            components.clampTicks(now);
+            for (auto &pair: orderMap)
+                ChangeTick::clamp(pair.second->lastRun, now);
+        }
+
+        void launch(TaskGroup &group, std::size_t index, float elapsed)
+        {
+            pool->run(group, [this, &group, index, elapsed]() {
+                runScheduled(index, elapsed);
+                for (auto next: schedule[index].successors) {
+                    if (remaining[next].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        launch(group, next, elapsed);
+                }
+            });
+        }
+
+        void runParallel(float elapsed)
+        {
+            TaskGroup group;
+            for (std::size_t i = 0; i < schedule.size(); i++)
+                remaining[i].store(schedule[i].dependencies, std::memory_order_relaxed);
+            for (std::size_t i = 0; i < schedule.size(); i++) {
+                if (schedule[i].dependencies == 0)
+                    launch(group, i, elapsed);
+            }
+            pool->wait(group);
+        }
+    public:
+        EntityManager() {
+            // Built first so that it outlives the manager, which logs when destroyed.
+            Logger::inst();
+            timeKeeper.start();
+        }
+
+        template    <typename T, typename ...Args>
+        T &smartCreate(Args ...args)
+        {
+            verifIsEntity<T>();
+            auto &system = creator<T>();
+            auto entity = construct<T>(args...);
+            initEntity(*entity);
+            own(*entity, system.id, true);
+            FENGIN_DEBUG("[", system.getName(), "] created ", typeid(T).name(), " with id ", entity->getId());
+            return *entity;
+        }
+
+        template <typename T, typename ...Args>
+        T &create(Args ...args)
+        {
+            verifIsEntity<T>();
+            auto &system = creator<T>();
+            auto entity = construct<T>(args...);
+            initEntity(*entity);
+            own(*entity, system.id, false);
+            return *entity;
+        };
+
+        // Entity living until the end of the current frame, allocated from an
+        // arena emptied at once. It belongs to no system and cannot be destroyed earlier.
+        template <typename T, typename ...Args>
+        T &createTransient(Args ...args)
+        {
+            verifIsEntity<T>();
+            auto entity = construct<T>(frameArena.allocate(sizeof(T), alignof(T)), args...);
+            transientEntities.push_back(entity);
+            initEntity(*entity);
+            return *entity;
+        }
+
+        // The entity named by handle, or nullptr once it was destroyed.
+        Entity *resolve(EntityHandle handle) const noexcept
+        {
+            if (handle.index >= slots.size() || slots[handle.index].generation != handle.generation)
+                return nullptr;
+            return slots[handle.index].entity;
+        }
+
+        bool alive(EntityHandle handle) const noexcept
+        {
+            return resolve(handle) != nullptr;
+        }
+
+        // Every live entity whose concrete type is exactly T, without allocating.
+        template <typename T>
+        EntityRange<T> entitiesOf() const
+        {
+            static_assert(std::is_base_of<Entity, T>::value, "Error : T is not an Entity");
+            auto it = entitiesByType.find(futils::type<T>::index);
+            if (it == entitiesByType.end())
+                return {};
+            return EntityRange<T>(it->second.data(), it->second.size());
+        }
+
+        template <typename T>
+        std::size_t countOf() const
+        {
+            return entitiesOf<T>().size();
+        }
+
+        // Transient entities, and those of another manager, are left alone.
+        bool destroy(Entity &entity)
+        {
+            if (entity.entityManager != this || entity.ownership == Entity::Ownership::None)
+                return false;
+            FENGIN_DEBUG(clock.system() != nullptr ? clock.system()->getName() : "[host]", ": Destroyed ", entity.ownership == Entity::Ownership::Saved ? "saved" : "temporary",
+                         " entity ", entity.getId(), " created by ", systemRecords[entity.owner].name);
+            disown(entity);
+            release(entity);
+            counter--;
+            return true;
+        }
+
+        template    <typename System, typename ...Args>
+        void addSystem(Args ...args)
+        {
+            if (!std::is_base_of<System, System>::value)
+                throw std::logic_error(std::string(typeid(System).name()) + " is not a System");
+            auto system = new System(args...);
+            if (!hasSystem(system->getName()))
+                initSystem(*system);
+            else
+                FENGIN_WARNING("[", system->getName(), "] already loaded.");
+        }
+
+        template <typename ...Args>
+        LoadStatus loadSystem(std::string const &path, Args ...args)
+        {
+            LoadStatus ret;
+            if (extensions.find(path) != extensions.end()) {
+                FENGIN_WARNING(path, " already loaded.");
+                return ret;
+            }
+            return installSystem(path, std::make_unique<futils::Dloader>(futils::Dloader(path)), args...);
+        };
+
+        // Opens the libraries of paths concurrently, on the thread pool or on
+        // threads of its own, then builds and initializes their systems one by
+        // one in the order of paths, so that loading stays deterministic.
+        // Returns a status per path. A library failing to open throws once the
+        // systems of the paths before it are initialized, like loadSystem would.
+        template <typename ...Args>
+        std::vector<LoadStatus> loadSystems(std::vector<std::string> const &paths, Args ...args)
+        {
+            std::vector<futils::UP<futils::Dloader>> libraries(paths.size());
+            std::vector<std::exception_ptr> errors(paths.size());
+            std::vector<std::size_t> toOpen;
+            std::unordered_set<std::string> seen;
+            for (std::size_t i = 0; i < paths.size(); i++) {
+                if (extensions.find(paths[i]) == extensions.end() && seen.insert(paths[i]).second)
+                    toOpen.push_back(i);
+            }
+            const auto open = [&libraries, &errors, &paths](std::size_t i) {
+                try {
+                    libraries[i] = std::make_unique<futils::Dloader>(futils::Dloader(paths[i]));
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            };
+            if (toOpen.size() > 1) {
+                futils::UP<ThreadPool> ownLoader;
+                auto *loader = pool;
+                if (loader == nullptr) {
+                    const auto threads = std::min<std::size_t>(toOpen.size(), std::max(1u, std::thread::hardware_concurrency()));
+                    ownLoader = std::make_unique<ThreadPool>(static_cast<unsigned int>(threads));
+                    loader = ownLoader.get();
+                }
+                TaskGroup group;
+                for (auto i: toOpen)
+                    loader->run(group, [&open, i]() { open(i); });
+                loader->wait(group);
+            } else {
+                for (auto i: toOpen)
+                    open(i);
+            }
+            std::vector<LoadStatus> res(paths.size());
+            for (std::size_t i = 0; i < paths.size(); i++) {
+                if (errors[i])
+                    std::rethrow_exception(errors[i]);
+                if (!libraries[i]) {
+                    FENGIN_WARNING(paths[i], " already loaded.");
+                    continue ;
+                }
+                res[i] = installSystem(paths[i], std::move(libraries[i]), args...);
+            }
+            return res;
+        }
+
+        bool hasSystem(std::string const &name) const
+        {
+            auto it = systemIds.find(name);
+            return it != systemIds.end() && systemRecords[it->second].system != nullptr;
+        }
+
+        void removeSystem(std::string const &systemName)
+        {
+            if (systemsMarkedForErase.find(systemName))
+                return ;
+            systemsMarkedForErase.push(systemName);
+        }
+
+        template <typename T>
+        std::vector<T *> get()
+        {
+            static_assert(IsComponent<T>::value, "Error : T is not a Component");
+            auto storage = components.find<T>();
+            if (storage == nullptr)
+                return {};
+            std::vector<T *> res;
+            res.reserve(storage->size());
+            for (auto &compo: *storage)
+                res.push_back(&compo);
+            return res;
+        };
+
+        // Allocation free alternative to get<T>() : iterates the entities owning
+        // all of Ts, either with a range-for over (entity, components...) tuples or each().
+        template <typename ...Ts>
+        View<Ts...> view() const
+        {
+            static_assert((IsComponent<Ts>::value && ...), "Error : T is not a Component");
+            return View<Ts...>(components.find<Ts>()...);
+        }
+
+        // view<Ts...>().each(fun), split in chunks run on the thread pool.
+        // See View::parallelEach.
+        template <typename ...Ts, typename Fun>
+        void parallelEach(Fun const &fun, std::size_t chunk = 1024) const
+        {
+            view<Ts...>().parallelEach(pool, fun, chunk);
+        }
+
+        // Change tick the calling system last ran at : what changed after it is new to it.
+        std::uint32_t lastRunTick() const noexcept
+        {
+            auto system = clock.system();
+            return system != nullptr ? system->lastRun : 0;
+        }
+
+        // Calls fun(Entity &, Ts &...) for the entities owning all of Ts where one
+        // of them was attached, or modified through Entity::modify or a storage's
+        // touch, since the calling system last ran.
+        template <typename ...Ts, typename Fun>
+        void changed(Fun &&fun) const
+        {
+            view<Ts...>().eachChanged(lastRunTick(), fun);
+        }
+
+        // Same, for components attached since the calling system last ran.
+        template <typename ...Ts, typename Fun>
+        void added(Fun &&fun) const
+        {
+            view<Ts...>().eachAdded(lastRunTick(), fun);
+        }
+
+        // Calls fun(int entityId) for every T detached, or whose entity was
+        // destroyed, since the calling system last ran. The id may have been
+        // given to a new entity since.
+        // Returns false when the system fell too far behind, typically while
+        // sleeping, and some removals were forgotten : it must rescan every T.
+        template <typename T, typename Fun>
+        bool removed(Fun &&fun) const
+        {
+            auto storage = components.find<T>();
+            return storage == nullptr || storage->eachRemoved(lastRunTick(), fun);
+        }
+
+        // Detaches T from every given entity owning one, sending ComponentDeleted
+        // for each. Returns how many were detached.
+        template <typename T>
+        std::size_t detach(std::vector<Entity *> const &entities)
+        {
+            auto storage = components.find<T>();
+            if (storage == nullptr)
+                return 0;
+            const auto id = ComponentType<T>::id();
+            std::size_t detached = 0;
+            for (auto entity: entities) {
+                if (!entity->mask.test(id))
+                    continue ;
+                events->send<ComponentDeleted<T>>(static_cast<const T &>(storage->get(entity->getId())), *entity);
+                storage->remove(entity->getId());
+                entity->mask.reset(id);
+                detached++;
+            }
+            return detached;
+        }
+
+        // Detaches every T at once : the storage is emptied without moving anything.
+        // ComponentDeleted reactions must not attach or detach T directly, use commands().
+        template <typename T>
+        std::size_t detachAll()
+        {
+            auto storage = components.find<T>();
+            if (storage == nullptr)
+                return 0;
+            const auto id = ComponentType<T>::id();
+            const auto detached = storage->size();
+            storage->each([this](T const &compo, Entity &entity) {
+                events->send<ComponentDeleted<T>>(compo, entity);
+            });
+            for (auto entity: storage->entities())
+                entity->mask.reset(id);
+            storage->clear();
+            return detached;
+        }
+
+        // Batched alternative to events->send<T>() : the event is appended to
+        // the channel of T and read by systems during the next frame with
+        // read<T>(). See EventChannel.
+        template <typename T, typename ...Args>
+        void post(Args &&...args)
+        {
+            channels.channel<T>().emplace(std::forward<Args>(args)...);
+            eventsSent++;
+        }
+
+        // Calls every handler subscribed to T right away. See System::subscribe.
+        template <typename T>
+        void emit(T const &event)
+        {
+            dispatcher.send(event);
+            eventsSent++;
+        }
+
+        Dispatcher &getDispatcher() noexcept
+        {
+            return dispatcher;
+        }
+
+        // Thread safe : queues T to be sent at the start of the next frame, to
+        // both the Mediator and the typed subscribers, in posting order.
+        // Never blocks : returns false and counts it when the queue is full.
+        template <typename T, typename ...Args>
+        bool enqueue(Args &&...args)
+        {
+            return mailbox.post<T>([](void *manager, void *memory) {
+                auto &event = *static_cast<T *>(memory);
+                struct  Destroy
+                {
+                    T &event;
+                    ~Destroy() { event.~T(); }
+                } destroy{event};
+                if (manager == nullptr)
+                    return ;
+                auto &self = *static_cast<EntityManager *>(manager);
+                self.events->send<T>(event);
+                self.dispatcher.send(event);
+            }, std::forward<Args>(args)...);
+        }
+
+        EventQueueStats getQueueStats() const noexcept
+        {
+            return mailbox.stats();
+        }
+
+        // Every T posted during the previous frame, in posting order.
+        template <typename T>
+        EventSpan<T> read() const noexcept
+        {
+            auto channel = channels.find<T>();
+            return channel ? channel->read() : EventSpan<T>();
+        }
+
+        template <typename T>
+        EventChannel<T> &channel()
+        {
+            return channels.channel<T>();
+        }
+
+        // Command buffer of the calling thread. See CommandBuffer.
+        CommandBuffer &commands();
+
+        // Applies every recorded command. Called by run() once systems are done.
+        void flushCommands();
+
+        // Snapshots : the slot table, every entity with its owner, and one
+        // column per component type, with an index of the columns at the end.
+        // Entity and component types must be registered in SnapshotRegistry.
+        // Transient entities are left out. Saving into the same buffer again
+        // reuses its memory.
+        void saveSnapshot(std::vector<unsigned char> &out) const;
+        void saveSnapshot(std::string const &path) const;
+
+        // Replaces every entity with the ones of a snapshot, under the same
+        // handles. Entities are rebuilt with their default constructor, then
+        // given the snapshot's components : state kept outside components is
+        // not restored. No creation nor attachment event is sent. Call it
+        // between frames. The world is left empty if loading fails.
+        void loadSnapshot(void const *data, std::size_t size);
+        // Maps the file rather than reading it.
+        void loadSnapshot(std::string const &path);
+
+        // Contiguous storage of every T, for systems that iterate a whole type.
+        template <typename T>
+        ComponentStorage<T> &storage()
+        {
+            static_assert(IsComponent<T>::value, "Error : T is not a Component");
+            return components.storage<T>();
+        }
+
+        // Entity owning compo, a component of this manager, or nullptr.
+        // The way back from plain data components, which do not store it.
+        template <typename T>
+        Entity *ownerOf(T const &compo) const noexcept
+        {
+            auto storage = components.find<T>();
+            return storage == nullptr ? nullptr : storage->ownerOf(compo);
+        }
+
+        void provideEventManager(EventManager &mediator) {
+            events = &mediator;
+        }
+
+        // Runs systems that declared their component access on a pool of
+        // threads workers. 0 goes back to running every system on the caller.
+        void setThreadCount(unsigned int threads)
+        {
+            ownPool.reset(threads > 0 ? new ThreadPool(threads) : nullptr);
+            pool = ownPool.get();
+        }
+
+        void provideThreadPool(ThreadPool &threadPool) {
+            pool = &threadPool;
+        }
+
+        ThreadPool *getThreadPool() const {
+            return pool;
+        }
+
+        // Records the last frames frames : see Profiler for what is kept, and
+        // getProfiler()->stats() or writeChromeTrace() to read it.
+        // From inside a frame, takes effect once the frame is over.
+        void enableProfiling(std::size_t frames = 600)
+        {
+            nextProfiler = std::make_unique<Profiler>(frames);
+            profilerPending = true;
+            if (!inFrame)
+                applyProfiling();
+        }
+
+        void disableProfiling()
+        {
+            nextProfiler.reset();
+            profilerPending = true;
+            if (!inFrame)
+                applyProfiling();
+        }
+
+        // Null unless profiling.
+        Profiler *getProfiler() const noexcept
+        {
+            return profiler.get();
+        }
+
+        bool hasPerFrameSystems()
+        {
+            if (scheduleDirty)
+                buildSchedule();
+            return perFrameSystems;
+        }
+
+        // How far the loop is between the last tick and the next one, in [0, 1).
+        float getInterpolation() const noexcept
+        {
+            return interpolation;
+        }
+
+        void setInterpolation(float alpha) noexcept
+        {
+            interpolation = alpha;
+        }
+
+        bool        isFine() const
+        {
+            return this->status == 0;
+        }
+
+        int getNumberOfSystems() const
+        {
+            return static_cast<int>(systemOrder.size());
+        }
+
+        void cleanSystems()
         {
             while (!systemsMarkedForErase.empty()) {
                 auto name = systemsMarkedForErase.front();
-                auto system = systemsMap.at(name);
+                systemsMarkedForErase.pop();
+                if (!hasSystem(name)) {
+                    FENGIN_WARNING("[", name, "] is not loaded, cannot remove it.");
+                    continue ;
+                }
+                auto &record = systemRecords[systemIds.at(name)];
+                auto system = record.system;
                 events->erase(system);
-                systemsMap.erase(name);
+                dispatcher.erase(system);
+                record.system = nullptr;
                 orderMap.erase(systemOrder[system]);
                 systemOrder.erase(system);
+                scheduleDirty = true;
                 auto afterDeath = system->getAfterDeath();
                 // Delete all temporary entities created by this system.
-                auto range = temporaryEntities.equal_range(name);
                 int entitiesDeleted = 0;
-                for (auto it = range.first; it != range.second; it++) {
-                    if (temporaryEntitiesRecords.find(it->second) == temporaryEntitiesRecords.end())
-                        continue ;
-                    delete it->second;
-                    temporaryEntitiesRecords.erase(it->second);
-                    entitiesDeleted++;
+                for (auto entity = record.temporaries; entity != nullptr; entitiesDeleted++) {
+                    auto next = entity->nextOwned;
+                    release(*entity);
+                    entity = next;
                 }
-                temporaryEntities.erase(name);
+                record.temporaries = nullptr;
                 SystemDestroyed sd;
                 sd.name = name;
                 events->send<SystemDestroyed>(sd);
-                events->send<std::string>("[" + name + "] shutdown. Killed " + std::to_string(entitiesDeleted) + " entities.");
+                FENGIN_INFO("[", name, "] shutdown. Killed ", entitiesDeleted, " entities.");
                 counter -= entitiesDeleted;
-                systemsMarkedForErase.pop();
                 delete system;
                 afterDeath(this);
                 if (extensionFiles.find(name) != extensionFiles.end()) {
@@ -519,32 +1595,557 @@ namespace fengin
 
         int run()
         {
+            return run(timeKeeper.loop());
+        }
+
+        // One frame lasting elapsed seconds, running the systems of pass only.
+        // The fixed timestep loop of FenginCore runs a Fixed frame per tick and
+        // a Variable one per iteration.
+        int run(float elapsed, RunPass only = RunPass::All)
+        {
+            inFrame = true;
             try {
-                auto elapsed = timeKeeper.loop();
-                for (auto &pair: orderMap)
-                {
-                    auto &system = pair.second;
-                    currentSystem = system;
-                    system->run(elapsed);
+                pass = only;
+                if (scheduleDirty)
+                    buildSchedule();
+                if (profiler)
+                    beginProfile();
+                nextTick();
+                // Events are delivered per tick : a Variable pass reads what the
+                // last Fixed one was given, and leaves what the ticks post alone.
+                if (only != RunPass::Variable) {
+                    eventsSent += mailbox.drain(this);
+                    channels.swap();
+                }
+                if (pool != nullptr && parallelSystems)
+                    runParallel(elapsed);
+                else {
+                    for (std::size_t i = 0; i < schedule.size(); i++)
+                        runScheduled(i, elapsed);
                 }
-                cleanSystems();
+                nextTick();
+                profileStep("[flushCommands]", [this]() { flushCommands(); });
+                releaseTransients();
+                profileStep("[cleanSystems]", [this]() { cleanSystems(); });
+                pruneRemovals();
+                checkTicks();
+                if (profiler)
+                    endProfile();
             } catch (std::out_of_range const &)
             {
                 if (!systemsMarkedForErase.empty()) {
-                    std::cout << "Failed to erase " << systemsMarkedForErase.front() << std::endl;
+                    FENGIN_ERROR("Failed to erase ", systemsMarkedForErase.front());
                     systemsMarkedForErase.pop();
                 }
 //                throw ;
+            } catch (...) {
+                finishFrame();
+                throw ;
             }
+            finishFrame();
             return 0;
         }
 
         ~EntityManager()
         {
             if (counter != 0)
-                std::cerr << "Leaked memory : " << counter << " entities leaked." << std::endl;
+                FENGIN_WARNING("Leaked memory : ", counter, " entities leaked.");
+            else
+                FENGIN_INFO("Clean exit. Have a nice day !");
+        }
+    };
+
+    // Records structural changes to apply later, when EntityManager::run() has
+    // run every system. Unlike direct calls, recording is safe while iterating a
+    // view and from systems running on the thread pool, since every thread gets
+    // its own buffer from EntityManager::commands().
+    // Commands are applied grouped : creations first, then attachments and
+    // detachments one component type at a time, then destructions. Attaching a
+    // component the entity owns by then does nothing.
+    class   CommandBuffer
+    {
+        struct  IComponentCommands
+        {
+            virtual ~IComponentCommands() {}
+            virtual bool empty() const noexcept = 0;
+            virtual void apply(EntityManager &manager) = 0;
+        };
+
+        // Entities are recorded by handle : commands aimed at an entity destroyed
+        // in the meantime are dropped.
+        template <typename T>
+        struct  ComponentCommands : public IComponentCommands
+        {
+            std::vector<std::pair<EntityHandle, T>> attached;
+            std::vector<EntityHandle> detached;
+
+            bool empty() const noexcept override
+            {
+                return attached.empty() && detached.empty();
+            }
+
+            void apply(EntityManager &manager) override
+            {
+                auto attaching = std::move(attached);
+                auto detaching = std::move(detached);
+                attached.clear();
+                detached.clear();
+                if (!attaching.empty())
+                    manager.template storage<T>().reserve(attaching.size());
+                for (auto &pair: attaching) {
+                    auto entity = manager.resolve(pair.first);
+                    if (entity != nullptr && !entity->template has<T>())
+                        entity->template attach<T>(std::move(pair.second));
+                }
+                std::vector<Entity *> entities;
+                entities.reserve(detaching.size());
+                for (auto handle: detaching) {
+                    if (auto entity = manager.resolve(handle))
+                        entities.push_back(entity);
+                }
+                if (!entities.empty())
+                    manager.template detach<T>(entities);
+            }
+        };
+
+        EntityManager &manager;
+        std::vector<std::function<void()>> creations;
+        std::vector<futils::UP<IComponentCommands>> components;
+        std::vector<std::pair<EntityHandle, System *>> destructions;
+
+        template <typename T>
+        ComponentCommands<T> &commandsOf()
+        {
+            const auto id = ComponentType<T>::id();
+            if (id >= components.size())
+                components.resize(id + 1);
+            if (!components[id])
+                components[id] = std::make_unique<ComponentCommands<T>>();
+            return static_cast<ComponentCommands<T> &>(*components[id]);
+        }
+    public:
+        explicit CommandBuffer(EntityManager &manager): manager(manager) {}
+
+        // Same as EntityManager::create, on behalf of the system recording it.
+        // Recording outside of a system throws.
+        template <typename T, typename ...Args>
+        void create(Args ...args)
+        {
+            auto system = &manager.template creator<T>();
+            creations.push_back([this, system, args...]() {
+                ChangeClock::Scope creating(manager.clock, system, manager.clock.now());
+                manager.create<T>(args...);
+            });
+        }
+
+        // Same as EntityManager::smartCreate, on behalf of the system recording it.
+        // Recording outside of a system throws.
+        template <typename T, typename ...Args>
+        void smartCreate(Args ...args)
+        {
+            auto system = &manager.template creator<T>();
+            creations.push_back([this, system, args...]() {
+                ChangeClock::Scope creating(manager.clock, system, manager.clock.now());
+                manager.smartCreate<T>(args...);
+            });
+        }
+
+        template <typename Compo, typename ...Args>
+        void attach(Entity &entity, Args ...args)
+        {
+            if constexpr (std::is_constructible<Compo, Args...>::value)
+                commandsOf<Compo>().attached.emplace_back(entity.getHandle(), Compo(args...));
             else
-                std::cout << "Clean exit. Have a nice day !" << std::endl;
+                commandsOf<Compo>().attached.emplace_back(entity.getHandle(), Compo{args...});
+        }
+
+        template <typename Compo>
+        void detach(Entity &entity)
+        {
+            commandsOf<Compo>().detached.push_back(entity.getHandle());
+        }
+
+        void destroy(Entity &entity)
+        {
+            destructions.emplace_back(entity.getHandle(), manager.clock.system());
+        }
+
+        bool empty() const noexcept
+        {
+            if (!creations.empty() || !destructions.empty())
+                return false;
+            for (auto &commands: components) {
+                if (commands && !commands->empty())
+                    return false;
+            }
+            return true;
+        }
+
+        // Applying is split in phases so that EntityManager::flushCommands can
+        // run each phase over every thread's buffer before the next one.
+        void applyCreations()
+        {
+            auto creating = std::move(creations);
+            creations.clear();
+            for (auto &create: creating)
+                create();
+        }
+
+        void applyComponents(ComponentId id)
+        {
+            if (id < components.size() && components[id] && !components[id]->empty())
+                components[id]->apply(manager);
+        }
+
+        std::size_t componentTypes() const noexcept
+        {
+            return components.size();
+        }
+
+        void takeDestructions(std::vector<std::pair<EntityHandle, System *>> &out)
+        {
+            out.insert(out.end(), destructions.begin(), destructions.end());
+            destructions.clear();
         }
     };
+
+    inline CommandBuffer &EntityManager::commands()
+    {
+        struct  Cache
+        {
+            unsigned int serial{0};
+            CommandBuffer *buffer{nullptr};
+        };
+        static thread_local Cache cache;
+        if (cache.buffer != nullptr && cache.serial == serial)
+            return *cache.buffer;
+        std::lock_guard<std::mutex> guard(commandsLock);
+        auto &buffer = commandBuffers[std::this_thread::get_id()];
+        if (!buffer)
+            buffer = std::make_shared<CommandBuffer>(*this);
+        cache.serial = serial;
+        cache.buffer = buffer.get();
+        return *buffer;
+    }
+
+    inline void EntityManager::flushCommands()
+    {
+        std::vector<std::shared_ptr<CommandBuffer>> buffers;
+        {
+            std::lock_guard<std::mutex> guard(commandsLock);
+            for (auto &pair: commandBuffers)
+                buffers.push_back(pair.second);
+        }
+        std::vector<std::pair<EntityHandle, System *>> destroying;
+        // Applying commands sends events, whose reactions may record more.
+        for (int pass = 0; pass < 8; pass++) {
+            const auto pending = std::any_of(buffers.begin(), buffers.end(), [](auto const &buffer) {
+                return !buffer->empty();
+            });
+            if (!pending)
+                break ;
+            for (auto &buffer: buffers)
+                buffer->applyCreations();
+            std::size_t types = 0;
+            for (auto &buffer: buffers)
+                types = std::max(types, buffer->componentTypes());
+            for (std::size_t id = 0; id < types; id++) {
+                for (auto &buffer: buffers)
+                    buffer->applyComponents(static_cast<ComponentId>(id));
+            }
+            destroying.clear();
+            for (auto &buffer: buffers)
+                buffer->takeDestructions(destroying);
+            std::stable_sort(destroying.begin(), destroying.end(), [](auto const &a, auto const &b) {
+                return a.first < b.first;
+            });
+            destroying.erase(std::unique(destroying.begin(), destroying.end(), [](auto const &a, auto const &b) {
+                return a.first == b.first;
+            }), destroying.end());
+            for (auto &pair: destroying) {
+                ChangeClock::Scope destroyer(clock, pair.second, clock.now());
+                if (auto entity = resolve(pair.first))
+                    destroy(*entity);
+            }
+        }
+    }
+
+    namespace snapshot
+    {
+        static constexpr char Magic[8] = {'F', 'E', 'N', 'G', 'S', 'N', 'A', 'P'};
+        static constexpr std::uint32_t Version = 1;
+
+        struct  Header
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t columns;
+            std::uint64_t slots;
+            std::uint64_t entities;
+            std::uint32_t freeSlots;
+            std::uint32_t padding;
+            std::uint64_t slotsOffset;
+            std::uint64_t entitiesOffset;
+            std::uint64_t indexOffset;
+        };
+
+        struct  Column
+        {
+            std::string name;
+            std::uint64_t count;
+            std::uint64_t idsOffset;
+            std::uint64_t dataOffset;
+        };
+    }
+
+    template <typename T>
+    void SnapshotRegistry::entity(std::string const &name)
+    {
+        static_assert(std::is_base_of<Entity, T>::value, "Error : T is not an Entity");
+        static_assert(std::is_default_constructible<T>::value, "Entities saved in snapshots must be default constructible");
+        std::lock_guard<std::mutex> guard(lock);
+        const auto type = futils::type<T>::index;
+        entitiesByType[type] = EntityCodec{name, type, [](EntityManager &manager, EntityHandle handle, ComponentStore &scratch) {
+            return manager.restoreEntity<T>(handle, scratch);
+        }};
+        entitiesByName[name] = type;
+    }
+
+    inline void EntityManager::saveSnapshot(std::vector<unsigned char> &out) const
+    {
+        auto &registry = SnapshotRegistry::inst();
+        out.clear();
+        SnapshotWriter writer(out);
+        snapshot::Header header{};
+        std::copy(std::begin(snapshot::Magic), std::end(snapshot::Magic), header.magic);
+        header.version = snapshot::Version;
+        header.slots = slots.size();
+        header.freeSlots = freeSlots;
+        writer.write(header);
+
+        // Slots of transient entities are saved as freed, like the end of the frame would.
+        std::vector<std::uint32_t> generations(slots.size());
+        std::vector<std::uint32_t> nextFree(slots.size());
+        for (std::size_t i = 0; i < slots.size(); i++) {
+            generations[i] = slots[i].generation;
+            nextFree[i] = slots[i].nextFree;
+        }
+        for (auto entity: transientEntities) {
+            const auto id = static_cast<std::uint32_t>(entity->getId());
+            generations[id]++;
+            nextFree[id] = header.freeSlots;
+            header.freeSlots = id;
+        }
+        writer.align(8);
+        header.slotsOffset = writer.size();
+        writer.bytes(generations.data(), generations.size() * sizeof(std::uint32_t));
+        writer.bytes(nextFree.data(), nextFree.size() * sizeof(std::uint32_t));
+
+        // Entities, as columns of ids, type names and owner names.
+        std::vector<std::uint32_t> ids;
+        std::vector<std::uint32_t> types;
+        std::vector<std::uint32_t> owners;
+        std::vector<std::uint8_t> temporary;
+        std::vector<std::string> typeNames;
+        std::vector<std::string> ownerNames;
+        std::unordered_map<futils::type_index, std::uint32_t> typeIndex;
+        // Owner names are only written for the systems owning something.
+        constexpr auto Unnamed = std::numeric_limits<std::uint32_t>::max();
+        std::vector<std::uint32_t> ownerIndex(systemRecords.size(), Unnamed);
+        std::vector<bool> kept(slots.size(), false);
+        for (std::uint32_t id = 0; id < slots.size(); id++) {
+            auto entity = slots[id].entity;
+            if (entity == nullptr || entity->ownership == Entity::Ownership::None)
+                continue ;  // Transient.
+            auto type = typeIndex.find(entity->getConcreteType());
+            if (type == typeIndex.end()) {
+                auto codec = registry.findEntity(entity->getConcreteType());
+                if (codec == nullptr)
+                    throw std::runtime_error(std::string("Cannot snapshot entity ") + std::to_string(id) + " : its type is not registered in SnapshotRegistry");
+                type = typeIndex.emplace(entity->getConcreteType(), static_cast<std::uint32_t>(typeNames.size())).first;
+                typeNames.push_back(codec->name);
+            }
+            auto &owner = ownerIndex[entity->owner];
+            if (owner == Unnamed) {
+                owner = static_cast<std::uint32_t>(ownerNames.size());
+                ownerNames.push_back(systemRecords[entity->owner].name);
+            }
+            ids.push_back(id);
+            types.push_back(type->second);
+            owners.push_back(owner);
+            temporary.push_back(entity->ownership == Entity::Ownership::Temporary);
+            kept[id] = true;
+        }
+        writer.align(8);
+        header.entitiesOffset = writer.size();
+        header.entities = ids.size();
+        writer.write(static_cast<std::uint32_t>(typeNames.size()));
+        for (auto &name: typeNames)
+            writer.write(name);
+        writer.write(static_cast<std::uint32_t>(ownerNames.size()));
+        for (auto &name: ownerNames)
+            writer.write(name);
+        writer(ids, types, owners, temporary);
+
+        // One column per component type.
+        std::vector<snapshot::Column> columns;
+        std::vector<int> columnIds;
+        components.each([&](ComponentId id, IComponentStorage const &storage) {
+            auto codec = registry.findComponent(id);
+            if (codec == nullptr)
+                throw std::runtime_error("Cannot snapshot component type " + std::to_string(id) + " : it is not registered in SnapshotRegistry");
+            auto const &all = storage.entityIds();
+            const bool everyOwnerKept = std::all_of(all.begin(), all.end(), [&kept](int entityId) {
+                return kept[entityId];
+            });
+            columnIds.clear();
+            if (!everyOwnerKept) {
+                for (auto entityId: all) {
+                    if (kept[entityId])
+                        columnIds.push_back(entityId);
+                }
+                if (columnIds.empty())
+                    return ;
+            }
+            auto const &saved = everyOwnerKept ? all : columnIds;
+            snapshot::Column column{codec->name, saved.size(), 0, 0};
+            writer.align(8);
+            column.idsOffset = writer.size();
+            for (auto entityId: saved)
+                writer.write(static_cast<std::uint32_t>(entityId));
+            writer.align(8);
+            column.dataOffset = writer.size();
+            codec->save(storage, saved, writer);
+            columns.push_back(std::move(column));
+        });
+
+        writer.align(8);
+        header.indexOffset = writer.size();
+        header.columns = static_cast<std::uint32_t>(columns.size());
+        for (auto &column: columns)
+            writer(column.name, column.count, column.idsOffset, column.dataOffset);
+        writer.patch(0, header);
+    }
+
+    inline void EntityManager::saveSnapshot(std::string const &path) const
+    {
+        std::vector<unsigned char> buffer;
+        saveSnapshot(buffer);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<char const *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        if (!out)
+            throw std::runtime_error("Cannot write snapshot " + path);
+    }
+
+    inline void EntityManager::loadSnapshot(void const *data, std::size_t size)
+    {
+        if (!transientEntities.empty())
+            throw std::logic_error("Cannot load a snapshot while transient entities are alive");
+        auto &registry = SnapshotRegistry::inst();
+        SnapshotReader reader(data, size);
+        const auto header = reader.read<snapshot::Header>();
+        if (!std::equal(std::begin(snapshot::Magic), std::end(snapshot::Magic), header.magic))
+            throw std::runtime_error("Not a snapshot");
+        if (header.version != snapshot::Version)
+            throw std::runtime_error("Unsupported snapshot version " + std::to_string(header.version));
+
+        // Everything is looked up before the world is touched.
+        reader.seek(header.entitiesOffset);
+        std::vector<SnapshotRegistry::EntityCodec const *> types(reader.read<std::uint32_t>());
+        for (auto &type: types) {
+            const auto name = reader.read<std::string>();
+            type = registry.findEntity(name);
+            if (type == nullptr)
+                throw std::runtime_error("Snapshot holds entities of unregistered type " + name);
+        }
+        std::vector<std::string> ownerNames(reader.read<std::uint32_t>());
+        for (auto &name: ownerNames)
+            reader.read(name);
+        std::vector<std::uint32_t> ids;
+        std::vector<std::uint32_t> typeIds;
+        std::vector<std::uint32_t> owners;
+        std::vector<std::uint8_t> temporary;
+        reader(ids, typeIds, owners, temporary);
+        if (ids.size() != header.entities || typeIds.size() != ids.size() || owners.size() != ids.size() || temporary.size() != ids.size())
+            throw std::runtime_error("Corrupted snapshot entity table");
+        for (std::size_t i = 0; i < ids.size(); i++) {
+            if (ids[i] >= header.slots || typeIds[i] >= types.size() || owners[i] >= ownerNames.size())
+                throw std::runtime_error("Corrupted snapshot entity table");
+        }
+        reader.seek(header.indexOffset);
+        std::vector<snapshot::Column> columns(header.columns);
+        std::vector<SnapshotRegistry::ComponentCodec const *> codecs(header.columns);
+        for (std::size_t i = 0; i < columns.size(); i++) {
+            auto &column = columns[i];
+            reader(column.name, column.count, column.idsOffset, column.dataOffset);
+            codecs[i] = registry.findComponent(column.name);
+            if (codecs[i] == nullptr)
+                throw std::runtime_error("Snapshot holds components of unregistered type " + column.name);
+        }
+
+        releaseAll();
+        try {
+            reader.seek(header.slotsOffset);
+            auto generations = reinterpret_cast<unsigned char const *>(reader.take(header.slots * sizeof(std::uint32_t)));
+            auto nextFree = reinterpret_cast<unsigned char const *>(reader.take(header.slots * sizeof(std::uint32_t)));
+            slots.assign(header.slots, EntitySlot{});
+            for (std::size_t i = 0; i < slots.size(); i++) {
+                std::memcpy(&slots[i].generation, generations + i * sizeof(std::uint32_t), sizeof(std::uint32_t));
+                std::memcpy(&slots[i].nextFree, nextFree + i * sizeof(std::uint32_t), sizeof(std::uint32_t));
+            }
+            freeSlots = header.freeSlots;
+
+            std::vector<std::uint32_t> ownerIds;
+            for (auto &name: ownerNames)
+                ownerIds.push_back(systemIdOf(name));
+            {
+                ComponentStore scratch;
+                for (std::size_t i = 0; i < ids.size(); i++) {
+                    const EntityHandle handle{ids[i], slots[ids[i]].generation};
+                    if (slots[ids[i]].entity != nullptr)
+                        throw std::runtime_error("Corrupted snapshot entity table");
+                    auto entity = types[typeIds[i]]->build(*this, handle, scratch);
+                    own(*entity, ownerIds[owners[i]], temporary[i] != 0);
+                    counter++;
+                    entitiesCreated++;
+                }
+            }
+
+            std::vector<int> columnIds;
+            std::vector<Entity *> columnOwners;
+            for (std::size_t i = 0; i < columns.size(); i++) {
+                auto &column = columns[i];
+                reader.seek(column.idsOffset);
+                auto first = reader.take(column.count * sizeof(std::uint32_t));
+                columnIds.resize(column.count);
+                columnOwners.resize(column.count);
+                for (std::size_t j = 0; j < column.count; j++) {
+                    std::uint32_t id;
+                    std::memcpy(&id, first + j * sizeof(id), sizeof(id));
+                    if (id >= slots.size() || slots[id].entity == nullptr || slots[id].entity->mask.test(codecs[i]->id))
+                        throw std::runtime_error("Corrupted snapshot column " + column.name);
+                    columnIds[j] = static_cast<int>(id);
+                    columnOwners[j] = slots[id].entity;
+                }
+                reader.seek(column.dataOffset);
+                codecs[i]->load(components, columnIds, columnOwners, reader);
+                for (auto owner: columnOwners)
+                    owner->mask.set(codecs[i]->id);
+            }
+        } catch (...) {
+            for (auto &slot: slots) {
+                if (slot.entity != nullptr)
+                    components.removeAll(slot.entity->getId());
+            }
+            releaseAll();
+            throw ;
+        }
+        FENGIN_INFO("Loaded a snapshot of ", ids.size(), " entities and ", columns.size(), " component types.");
+    }
+
+    inline void EntityManager::loadSnapshot(std::string const &path)
+    {
+        MappedFile file(path);
+        loadSnapshot(file.data(), file.size());
+    }
 }
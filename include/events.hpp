@@ -51,10 +51,11 @@ namespace fengin::events {
         }
     };
 
+    // Resolve through EntityManager::resolve : either may be gone by delivery.
     struct Collision
     {
-        Entity *first;
-        Entity *second;
+        EntityHandle first;
+        EntityHandle second;
     };
 }
 
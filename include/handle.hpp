@@ -0,0 +1,37 @@
+#pragma once
+
+# include <cstdint>
+# include <functional>
+
+namespace fengin
+{
+    // Names an entity without pointing to it : an index in the EntityManager's
+    // slot table, and the generation of that slot when the entity was created.
+    // Slots are reused, but their generation is bumped each time, so a handle
+    // to a destroyed entity is detected instead of reaching its successor.
+    struct  EntityHandle
+    {
+        static constexpr std::uint32_t Invalid = ~std::uint32_t(0);
+
+        std::uint32_t index{Invalid};
+        std::uint32_t generation{0};
+
+        bool valid() const noexcept { return index != Invalid; }
+        std::uint64_t value() const noexcept { return (std::uint64_t(generation) << 32) | index; }
+        bool operator==(EntityHandle const &other) const noexcept { return value() == other.value(); }
+        bool operator!=(EntityHandle const &other) const noexcept { return value() != other.value(); }
+        bool operator<(EntityHandle const &other) const noexcept { return value() < other.value(); }
+    };
+}
+
+namespace std
+{
+    template <>
+    struct  hash<fengin::EntityHandle>
+    {
+        std::size_t operator()(fengin::EntityHandle const &handle) const noexcept
+        {
+            return std::hash<std::uint64_t>()(handle.value());
+        }
+    };
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+# include <array>
+# include <mutex>
+# include <atomic>
+# include <chrono>
+# include <algorithm>
+# include <cstdio>
+# include <cstring>
+# include <cstdint>
+# include <string>
+# include <thread>
+# include <iostream>
+# include <type_traits>
+# include <condition_variable>
+
+// Messages below FENGIN_LOG_LEVEL are compiled out : 0 Trace, 1 Debug,
+// 2 Info, 3 Warning, 4 Error, 5 nothing at all.
+# ifndef FENGIN_LOG_LEVEL
+#  define FENGIN_LOG_LEVEL 2
+# endif
+
+namespace fengin
+{
+    enum class LogLevel : std::uint8_t
+    {
+        Trace,
+        Debug,
+        Info,
+        Warning,
+        Error,
+        Off
+    };
+
+    // One message, formatted in place : nothing is allocated to log it.
+    // Text past Size bytes is cut.
+    struct  LogRecord
+    {
+        static constexpr std::size_t Size = 224;
+
+        LogLevel level{LogLevel::Info};
+        std::uint32_t length{0};
+        char text[Size];
+
+        void append(char const *str, std::size_t n) noexcept
+        {
+            n = std::min(n, Size - length);
+            std::memcpy(text + length, str, n);
+            length += static_cast<std::uint32_t>(n);
+        }
+
+        void append(char const *str) noexcept { append(str, std::strlen(str)); }
+        void append(std::string const &str) noexcept { append(str.data(), str.size()); }
+        void append(char c) noexcept { append(&c, 1); }
+        void append(bool b) noexcept { append(b ? "true" : "false"); }
+        void append(void const *ptr) noexcept { appendFormat("%p", ptr); }
+
+        template <typename T>
+        std::enable_if_t<std::is_arithmetic<T>::value> append(T value) noexcept
+        {
+            if constexpr (std::is_floating_point<T>::value)
+                appendFormat("%g", static_cast<double>(value));
+            else if constexpr (std::is_signed<T>::value)
+                appendFormat("%lld", static_cast<long long>(value));
+            else
+                appendFormat("%llu", static_cast<unsigned long long>(value));
+        }
+
+        template <typename T>
+        std::enable_if_t<std::is_enum<T>::value> append(T value) noexcept
+        {
+            append(static_cast<std::underlying_type_t<T>>(value));
+        }
+    private:
+        template <typename T>
+        void appendFormat(char const *format, T value) noexcept
+        {
+            char buffer[32];
+            const auto n = std::snprintf(buffer, sizeof(buffer), format, value);
+            if (n > 0)
+                append(buffer, std::min<std::size_t>(n, sizeof(buffer) - 1));
+        }
+    };
+
+    // Process wide logger. Any thread formats its message into a slot of a
+    // bounded lock-free ring, and a background thread writes them out in
+    // batches : Warning and above to std::cerr, the rest to std::cout, with a
+    // single flush per batch. When the ring is full, messages are dropped and
+    // counted rather than blocking the caller.
+    class   Logger
+    {
+        static constexpr std::size_t Capacity = 4096;
+
+        struct  Slot
+        {
+            std::atomic<std::size_t> sequence;
+            LogRecord record;
+        };
+
+        std::array<Slot, Capacity> ring;
+        alignas(64) std::atomic<std::size_t> head{0};
+        alignas(64) std::size_t tail{0};
+        std::atomic<LogLevel> level{static_cast<LogLevel>(FENGIN_LOG_LEVEL)};
+        std::atomic<std::uint64_t> dropped{0};
+        std::atomic<bool> stopping{false};
+        std::mutex sleepLock;
+        std::condition_variable wakeUp;
+        std::thread writer;
+
+        Logger()
+        {
+            for (std::size_t i = 0; i < Capacity; i++)
+                ring[i].sequence.store(i, std::memory_order_relaxed);
+            writer = std::thread([this]() { work(); });
+        }
+
+        bool drain()
+        {
+            bool wrote = false;
+            bool toOut = false;
+            bool toErr = false;
+            for (;;) {
+                auto &slot = ring[tail % Capacity];
+                if (slot.sequence.load(std::memory_order_acquire) != tail + 1)
+                    break ;
+                auto &record = slot.record;
+                auto &stream = record.level >= LogLevel::Warning ? std::cerr : std::cout;
+                stream.write(record.text, record.length);
+                stream.put('\n');
+                (record.level >= LogLevel::Warning ? toErr : toOut) = true;
+                slot.sequence.store(tail + Capacity, std::memory_order_release);
+                tail++;
+                wrote = true;
+            }
+            const auto lost = dropped.exchange(0, std::memory_order_relaxed);
+            if (lost > 0) {
+                std::cerr << "[log] " << lost << " messages dropped" << '\n';
+                toErr = true;
+            }
+            if (toOut)
+                std::cout.flush();
+            if (toErr)
+                std::cerr.flush();
+            return wrote;
+        }
+
+        void work()
+        {
+            while (!stopping.load(std::memory_order_acquire)) {
+                if (drain())
+                    continue ;
+                std::unique_lock<std::mutex> guard(sleepLock);
+                wakeUp.wait_for(guard, std::chrono::milliseconds(10));
+            }
+            drain();
+        }
+    public:
+        Logger(Logger const &) = delete;
+        Logger &operator=(Logger const &) = delete;
+
+        ~Logger()
+        {
+            stopping.store(true, std::memory_order_release);
+            wakeUp.notify_one();
+            writer.join();
+        }
+
+        static Logger &inst()
+        {
+            static Logger logger;
+            return logger;
+        }
+
+        static constexpr bool compiled(LogLevel at) noexcept
+        {
+            return static_cast<int>(at) + 1 > FENGIN_LOG_LEVEL;
+        }
+
+        // Runtime threshold, on top of FENGIN_LOG_LEVEL.
+        void setLevel(LogLevel threshold) noexcept { level.store(threshold, std::memory_order_relaxed); }
+        LogLevel getLevel() const noexcept { return level.load(std::memory_order_relaxed); }
+
+        bool enabled(LogLevel at) const noexcept
+        {
+            return at >= getLevel();
+        }
+
+        template <typename ...Args>
+        void write(LogLevel at, Args const &...args) noexcept
+        {
+            auto pos = head.load(std::memory_order_relaxed);
+            Slot *slot;
+            for (;;) {
+                slot = &ring[pos % Capacity];
+                const auto sequence = slot->sequence.load(std::memory_order_acquire);
+                if (sequence == pos) {
+                    if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break ;
+                } else if (sequence < pos) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return ;
+                } else
+                    pos = head.load(std::memory_order_relaxed);
+            }
+            auto &record = slot->record;
+            record.level = at;
+            record.length = 0;
+            (record.append(args), ...);
+            slot->sequence.store(pos + 1, std::memory_order_release);
+        }
+
+        // Waits for every message logged so far to be written.
+        void flush()
+        {
+            const auto until = head.load(std::memory_order_acquire);
+            wakeUp.notify_one();
+            while (true) {
+                const auto &slot = ring[(until + Capacity - 1) % Capacity];
+                if (until == 0 || slot.sequence.load(std::memory_order_acquire) >= until - 1 + Capacity)
+                    break ;
+                std::this_thread::yield();
+            }
+        }
+
+        std::uint64_t droppedCount() const noexcept
+        {
+            return dropped.load(std::memory_order_relaxed);
+        }
+    };
+}
+
+// Arguments are only evaluated when the level is enabled, and not even
+// compiled below FENGIN_LOG_LEVEL.
+# define FENGIN_LOG(lvl, ...) do { \
+        if constexpr (fengin::Logger::compiled(fengin::LogLevel::lvl)) { \
+            if (fengin::Logger::inst().enabled(fengin::LogLevel::lvl)) \
+                fengin::Logger::inst().write(fengin::LogLevel::lvl, __VA_ARGS__); \
+        } \
+    } while (0)
+
+# define FENGIN_TRACE(...) FENGIN_LOG(Trace, __VA_ARGS__)
+# define FENGIN_DEBUG(...) FENGIN_LOG(Debug, __VA_ARGS__)
+# define FENGIN_INFO(...) FENGIN_LOG(Info, __VA_ARGS__)
+# define FENGIN_WARNING(...) FENGIN_LOG(Warning, __VA_ARGS__)
+# define FENGIN_ERROR(...) FENGIN_LOG(Error, __VA_ARGS__)
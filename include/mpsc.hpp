@@ -0,0 +1,174 @@
+#pragma once
+
+# include <new>
+# include <atomic>
+# include <cstddef>
+# include <cstdint>
+# include <utility>
+# include <stdexcept>
+# include <type_traits>
+# include "utils/types.hpp"
+
+# ifndef FENGIN_QUEUED_EVENT_SIZE
+#  define FENGIN_QUEUED_EVENT_SIZE 96
+# endif
+
+namespace fengin
+{
+    struct  EventQueueStats
+    {
+        std::uint64_t posted{0};    // Accepted since the queue was built.
+        std::uint64_t dropped{0};   // Refused because the queue was full.
+        std::uint64_t delivered{0};
+        std::size_t highWater{0};   // Most events ever waiting at once.
+        std::size_t capacity{0};
+    };
+
+    // Bounded lock-free queue of events of any type, posted from any thread
+    // and drained by a single consumer. Each event is moved into a slot of
+    // a ring with the function that will deliver it, so posting never
+    // allocates nor blocks : a full queue refuses the event and counts it.
+    class   EventQueue
+    {
+    public:
+        static constexpr std::size_t EventSize = FENGIN_QUEUED_EVENT_SIZE;
+        // Delivers event to context then destroys it. A null context only destroys it.
+        using Deliver = void (*)(void *context, void *event);
+    private:
+        struct  Slot
+        {
+            std::atomic<std::size_t> sequence;
+            Deliver deliver;
+            alignas(std::max_align_t) unsigned char event[EventSize];
+        };
+
+        futils::UP<Slot[]> slots;
+        std::size_t mask;
+        alignas(64) std::atomic<std::size_t> head{0};
+        alignas(64) std::atomic<std::size_t> tail{0};
+        std::atomic<std::uint64_t> dropped{0};
+        std::atomic<std::size_t> highWater{0};
+        std::uint64_t delivered{0};
+    public:
+        // capacity is rounded up to a power of two.
+        explicit EventQueue(std::size_t capacity = 4096)
+        {
+            std::size_t size = 2;
+            while (size < capacity)
+                size *= 2;
+            slots.reset(new Slot[size]);
+            mask = size - 1;
+            for (std::size_t i = 0; i < size; i++)
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        EventQueue(EventQueue const &) = delete;
+        EventQueue &operator=(EventQueue const &) = delete;
+
+        ~EventQueue()
+        {
+            clear();
+        }
+
+        // Builds a T in the queue, to be given to deliver when drained.
+        // deliver must destroy it. Returns false when the queue is full.
+        template <typename T, typename ...Args>
+        bool post(Deliver deliver, Args &&...args)
+        {
+            static_assert(sizeof(T) <= EventSize, "Event too big to be queued, post a pointer or raise FENGIN_QUEUED_EVENT_SIZE");
+            static_assert(alignof(T) <= alignof(std::max_align_t), "Event over-aligned, cannot be queued");
+            auto pos = head.load(std::memory_order_relaxed);
+            Slot *slot;
+            for (;;) {
+                slot = &slots[pos & mask];
+                const auto sequence = slot->sequence.load(std::memory_order_acquire);
+                if (sequence == pos) {
+                    if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break ;
+                } else if (sequence < pos) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                } else
+                    pos = head.load(std::memory_order_relaxed);
+            }
+            try {
+                if constexpr (std::is_constructible<T, Args &&...>::value)
+                    new (slot->event) T(std::forward<Args>(args)...);
+                else
+                    new (slot->event) T{std::forward<Args>(args)...};
+            } catch (...) {
+                // The slot is taken : hand the consumer nothing to deliver.
+                slot->deliver = nullptr;
+                slot->sequence.store(pos + 1, std::memory_order_release);
+                throw ;
+            }
+            slot->deliver = deliver;
+            slot->sequence.store(pos + 1, std::memory_order_release);
+            // A concurrent drain may already be past this event : nothing waits then.
+            const auto read = tail.load(std::memory_order_relaxed);
+            if (read <= pos + 1) {
+                const auto waiting = pos + 1 - read;
+                auto high = highWater.load(std::memory_order_relaxed);
+                while (waiting > high && !highWater.compare_exchange_weak(high, waiting, std::memory_order_relaxed));
+            }
+            return true;
+        }
+
+        // Consumer side : delivers the events posted before the call, in
+        // posting order, and returns how many. Events posted meanwhile wait
+        // for the next drain.
+        std::size_t drain(void *context)
+        {
+            const auto until = head.load(std::memory_order_acquire);
+            std::size_t count = 0;
+            for (auto pos = tail.load(std::memory_order_relaxed); pos != until; pos++) {
+                auto &slot = slots[pos & mask];
+                if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+                    break ;
+                const auto deliver = slot.deliver;
+                // Release the slot even if delivering throws.
+                struct  Release
+                {
+                    EventQueue &queue;
+                    Slot &slot;
+                    std::size_t pos;
+                    ~Release()
+                    {
+                        slot.sequence.store(pos + queue.mask + 1, std::memory_order_release);
+                        queue.tail.store(pos + 1, std::memory_order_relaxed);
+                    }
+                } release{*this, slot, pos};
+                if (deliver != nullptr) {
+                    deliver(context, slot.event);
+                    count++;
+                }
+            }
+            if (context != nullptr)
+                delivered += count;
+            return count;
+        }
+
+        // Consumer side : destroys the waiting events without delivering them.
+        void clear()
+        {
+            drain(nullptr);
+        }
+
+        std::size_t capacity() const noexcept
+        {
+            return mask + 1;
+        }
+
+        // Consumer side.
+        EventQueueStats stats() const noexcept
+        {
+            EventQueueStats stats;
+            stats.dropped = dropped.load(std::memory_order_relaxed);
+            stats.delivered = delivered;
+            stats.posted = head.load(std::memory_order_relaxed);
+            stats.highWater = highWater.load(std::memory_order_relaxed);
+            stats.capacity = capacity();
+            return stats;
+        }
+    };
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+# include <string>
+# include <vector>
+# include <fstream>
+# include <sstream>
+# include <cstdint>
+# include <algorithm>
+# include <unordered_map>
+# include <stdexcept>
+# include <experimental/filesystem>
+# include <sys/stat.h>
+
+namespace fengin
+{
+    // What a previous start found in the system directories : the entries of
+    // each directory as of its last modification, and the system built from
+    // each library as of its size and modification time. A directory that
+    // changed since is listed again, a library that changed since forgets its
+    // system. Libraries are still stat'ed once each : a library rewritten in
+    // place does not touch its directory.
+    // Saved as tab separated lines, one per directory and one per entry.
+    class   PluginManifest
+    {
+        static constexpr const char *Header = "fengin-plugins 1";
+    public:
+        struct  Entry
+        {
+            std::string path;
+            bool directory{false};
+            bool symlink{false};
+            std::uintmax_t size{0};
+            std::int64_t modified{0};
+            std::string system;    // Empty until a system was built from it.
+        };
+
+        struct  Directory
+        {
+            std::int64_t modified{0};
+            std::vector<Entry> entries;     // Sorted by path.
+        };
+    private:
+        std::unordered_map<std::string, Directory> directories;
+        bool dirty{false};
+
+        static std::int64_t modifiedTime(std::experimental::filesystem::path const &path)
+        {
+            return std::experimental::filesystem::last_write_time(path).time_since_epoch().count();
+        }
+    public:
+        // A missing or unreadable manifest is an empty one.
+        bool load(std::string const &path)
+        {
+            std::ifstream in(path);
+            std::string line;
+            if (!std::getline(in, line) || line != Header)
+                return false;
+            Directory *current = nullptr;
+            while (std::getline(in, line)) {
+                std::istringstream fields(line);
+                std::string kind;
+                std::getline(fields, kind, '\t');
+                if (kind == "dir") {
+                    std::string modified, name;
+                    std::getline(fields, modified, '\t');
+                    std::getline(fields, name);
+                    current = &directories[name];
+                    current->modified = std::stoll(modified);
+                } else if (current != nullptr && (kind == "file" || kind == "link" || kind == "subdir")) {
+                    Entry entry;
+                    std::string size, modified;
+                    entry.directory = kind == "subdir";
+                    entry.symlink = kind == "link";
+                    std::getline(fields, size, '\t');
+                    std::getline(fields, modified, '\t');
+                    std::getline(fields, entry.system, '\t');
+                    std::getline(fields, entry.path);
+                    entry.size = std::stoull(size);
+                    entry.modified = std::stoll(modified);
+                    current->entries.push_back(std::move(entry));
+                }
+            }
+            dirty = false;
+            return true;
+        }
+
+        // Writes the manifest if anything changed since it was loaded.
+        void save(std::string const &path)
+        {
+            if (!dirty)
+                return ;
+            std::ofstream out(path, std::ios::trunc);
+            out << Header << "\n";
+            for (auto &pair: directories) {
+                out << "dir\t" << pair.second.modified << "\t" << pair.first << "\n";
+                for (auto &entry: pair.second.entries) {
+                    out << (entry.directory ? "subdir" : entry.symlink ? "link" : "file") << "\t"
+                        << entry.size << "\t" << entry.modified << "\t" << entry.system << "\t" << entry.path << "\n";
+                }
+            }
+            dirty = false;
+        }
+
+        // Entries of path, listed again only if it changed since the last scan.
+        std::vector<Entry> &scan(std::string const &path)
+        {
+            namespace fs = std::experimental::filesystem;
+            const auto modified = modifiedTime(path);
+            auto it = directories.find(path);
+            if (it != directories.end() && it->second.modified == modified)
+                return it->second.entries;
+            auto &directory = directories[path];
+            directory.modified = modified;
+            directory.entries.clear();
+            for (auto &p: fs::directory_iterator(path)) {
+                Entry entry;
+                entry.path = p.path().string();
+                entry.directory = fs::is_directory(p.path());
+                entry.symlink = fs::is_symlink(p.path());
+                directory.entries.push_back(std::move(entry));
+            }
+            std::sort(directory.entries.begin(), directory.entries.end(), [](Entry const &a, Entry const &b) {
+                return a.path < b.path;
+            });
+            dirty = true;
+            return directory.entries;
+        }
+
+        // The system last built from entry, or an empty string if the library
+        // changed since or was never loaded. One stat per call.
+        std::string const &systemOf(Entry &entry)
+        {
+            struct stat info;
+            if (::stat(entry.path.c_str(), &info) != 0)
+                throw std::runtime_error("Cannot stat " + entry.path);
+            const auto size = static_cast<std::uintmax_t>(info.st_size);
+            const auto modified = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+            if (size != entry.size || modified != entry.modified) {
+                entry.size = size;
+                entry.modified = modified;
+                entry.system.clear();
+                dirty = true;
+            }
+            return entry.system;
+        }
+
+        void record(Entry &entry, std::string const &system)
+        {
+            if (entry.system != system) {
+                entry.system = system;
+                dirty = true;
+            }
+        }
+    };
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+# include <new>
+# include <atomic>
+# include <vector>
+# include <cstddef>
+# include <cstdint>
+# include <algorithm>
+
+namespace fengin
+{
+    // Blocks the engine's pools, arenas and storages asked to the system
+    // allocator, since the start of the process.
+    struct  MemoryStats
+    {
+        static std::atomic<std::uint64_t> &allocations() noexcept
+        {
+            static std::atomic<std::uint64_t> count{0};
+            return count;
+        }
+
+        static void allocated() noexcept
+        {
+            allocations().fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    // Fixed-size blocks carved out of slabs. Freed blocks go to a free list and
+    // are handed out again before any new slab is allocated.
+    class   BlockPool
+    {
+        struct  FreeBlock
+        {
+            FreeBlock *next;
+        };
+
+        std::size_t blockSize;
+        std::size_t alignment;
+        std::size_t blocksPerSlab;
+        std::vector<void *> slabs;
+        FreeBlock *freeList{nullptr};
+        std::size_t live{0};
+
+        void grow()
+        {
+            auto slab = static_cast<unsigned char *>(::operator new(blockSize * blocksPerSlab, std::align_val_t(alignment)));
+            slabs.push_back(slab);
+            MemoryStats::allocated();
+            for (std::size_t i = blocksPerSlab; i-- > 0;) {
+                auto block = reinterpret_cast<FreeBlock *>(slab + i * blockSize);
+                block->next = freeList;
+                freeList = block;
+            }
+        }
+    public:
+        BlockPool(std::size_t size, std::size_t align, std::size_t blocksPerSlab = 64):
+                alignment(std::max(align, alignof(FreeBlock))), blocksPerSlab(blocksPerSlab)
+        {
+            size = std::max(size, sizeof(FreeBlock));
+            blockSize = (size + alignment - 1) / alignment * alignment;
+        }
+
+        BlockPool(BlockPool const &) = delete;
+        BlockPool &operator=(BlockPool const &) = delete;
+
+        ~BlockPool()
+        {
+            for (auto slab: slabs)
+                ::operator delete(slab, std::align_val_t(alignment));
+        }
+
+        void *allocate()
+        {
+            if (freeList == nullptr)
+                grow();
+            auto block = freeList;
+            freeList = block->next;
+            live++;
+            return block;
+        }
+
+        void deallocate(void *memory) noexcept
+        {
+            auto block = static_cast<FreeBlock *>(memory);
+            block->next = freeList;
+            freeList = block;
+            live--;
+        }
+
+        std::size_t size() const noexcept { return live; }
+        std::size_t capacity() const noexcept { return slabs.size() * blocksPerSlab; }
+    };
+
+    // Bump allocator emptied all at once. Chunks are kept between resets, so a
+    // steady workload stops allocating after its first frames.
+    class   FrameArena
+    {
+        static constexpr std::size_t ChunkSize = 64 * 1024;
+        static constexpr std::size_t ChunkAlignment = 64;
+
+        struct  Chunk
+        {
+            unsigned char *memory;
+            std::size_t size;
+        };
+
+        std::vector<Chunk> chunks;
+        std::size_t current{0};
+        std::size_t offset{0};
+    public:
+        FrameArena() = default;
+        FrameArena(FrameArena const &) = delete;
+        FrameArena &operator=(FrameArena const &) = delete;
+
+        ~FrameArena()
+        {
+            for (auto &chunk: chunks)
+                ::operator delete(chunk.memory, std::align_val_t(ChunkAlignment));
+        }
+
+        void *allocate(std::size_t size, std::size_t align)
+        {
+            while (current < chunks.size()) {
+                const auto base = reinterpret_cast<std::uintptr_t>(chunks[current].memory);
+                const auto start = (base + offset + align - 1) / align * align - base;
+                if (start + size <= chunks[current].size) {
+                    offset = start + size;
+                    return chunks[current].memory + start;
+                }
+                current++;
+                offset = 0;
+            }
+            const auto chunkSize = std::max(ChunkSize, size + align);
+            auto memory = static_cast<unsigned char *>(::operator new(chunkSize, std::align_val_t(ChunkAlignment)));
+            chunks.push_back({memory, chunkSize});
+            MemoryStats::allocated();
+            current = chunks.size() - 1;
+            offset = 0;
+            return allocate(size, align);
+        }
+
+        void reset() noexcept
+        {
+            current = 0;
+            offset = 0;
+        }
+    };
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+# include <chrono>
+# include <string>
+# include <vector>
+# include <ostream>
+# include <iomanip>
+# include <cstdint>
+# include <algorithm>
+# include <functional>
+# include <unordered_map>
+# include <thread>
+
+namespace fengin
+{
+    struct  ProfileSample
+    {
+        std::uint32_t name;     // Index in Profiler::getNames().
+        std::uint32_t thread;
+        std::int64_t start;     // Nanoseconds since the profiler was built.
+        std::int64_t duration;
+    };
+
+    struct  FrameProfile
+    {
+        std::uint64_t frame{0};
+        std::int64_t start{0};
+        std::int64_t duration{0};
+        std::vector<ProfileSample> samples;
+        std::uint64_t entitiesCreated{0};
+        std::uint64_t entitiesDestroyed{0};
+        std::uint64_t componentsAttached{0};
+        std::uint64_t componentsDetached{0};
+        std::uint64_t eventsSent{0};     // Through EntityManager : emitted, posted and delivered from the queue.
+        std::uint64_t allocations{0};    // Blocks asked to the system allocator by pools, arenas and storages.
+    };
+
+    struct  ProfileStats
+    {
+        std::string name;
+        std::size_t calls{0};
+        double mean{0};     // Milliseconds.
+        double p50{0};
+        double p99{0};
+        double max{0};
+    };
+
+    // Records what happens in the last frames of an EntityManager into a ring
+    // of FrameProfile : every system run, the command flush and the system
+    // cleanup, with the churn counters of the frame. Frames are recycled with
+    // their sample buffers, so profiling a steady workload does not allocate.
+    // Samples of a frame are written by the threads running its systems, each
+    // in a slot reserved beforehand.
+    class   Profiler
+    {
+        using Clock = std::chrono::steady_clock;
+
+        Clock::time_point origin{Clock::now()};
+        std::vector<FrameProfile> frames;
+        std::size_t next{0};
+        std::uint64_t count{0};
+        std::vector<std::string> names;
+        std::unordered_map<std::string, std::uint32_t> nameIds;
+        FrameProfile *current{nullptr};
+        std::size_t reserved{0};
+
+        static std::uint32_t threadId()
+        {
+            return static_cast<std::uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()) & 0xffff);
+        }
+    public:
+        explicit Profiler(std::size_t capacity = 600): frames(std::max<std::size_t>(capacity, 1)) {}
+
+        std::int64_t now() const noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count();
+        }
+
+        std::uint32_t nameId(std::string const &name)
+        {
+            auto it = nameIds.find(name);
+            if (it != nameIds.end())
+                return it->second;
+            const auto id = static_cast<std::uint32_t>(names.size());
+            names.push_back(name);
+            nameIds.emplace(name, id);
+            return id;
+        }
+
+        // Starts a frame with slots samples ready to be filled with record().
+        FrameProfile &beginFrame(std::size_t slots)
+        {
+            current = &frames[next];
+            next = (next + 1) % frames.size();
+            *current = FrameProfile{count++, now(), 0, std::move(current->samples)};
+            current->samples.assign(slots, ProfileSample{0, 0, 0, -1});
+            reserved = slots;
+            return *current;
+        }
+
+        // Fills slot, reserved by beginFrame. Thread safe between different slots.
+        void record(std::size_t slot, std::uint32_t name, std::int64_t start)
+        {
+            current->samples[slot] = {name, threadId(), start, now() - start};
+        }
+
+        // Main thread only.
+        void record(std::uint32_t name, std::int64_t start)
+        {
+            current->samples.push_back({name, threadId(), start, now() - start});
+        }
+
+        FrameProfile *frame() noexcept
+        {
+            return current;
+        }
+
+        void endFrame()
+        {
+            auto &samples = current->samples;
+            // Drop the reserved slots of systems that did not run this frame.
+            samples.erase(std::remove_if(samples.begin(), samples.end(), [](auto const &sample) {
+                return sample.duration < 0;
+            }), samples.end());
+            current->duration = now() - current->start;
+        }
+
+        std::vector<std::string> const &getNames() const noexcept
+        {
+            return names;
+        }
+
+        // Calls fun(FrameProfile const &) on the recorded frames, oldest first.
+        template <typename Fun>
+        void eachFrame(Fun &&fun) const
+        {
+            const auto recorded = std::min<std::uint64_t>(count, frames.size());
+            for (std::size_t i = 0; i < recorded; i++) {
+                auto &frame = frames[(next + frames.size() - recorded + i) % frames.size()];
+                if (&frame != current || current->duration > 0)
+                    fun(frame);
+            }
+        }
+
+        // Rolling statistics over the recorded frames : one entry per name,
+        // then one named "frame" for whole frames.
+        std::vector<ProfileStats> stats() const
+        {
+            std::vector<std::vector<std::int64_t>> durations(names.size() + 1);
+            eachFrame([&durations, this](FrameProfile const &frame) {
+                for (auto &sample: frame.samples)
+                    durations[sample.name].push_back(sample.duration);
+                durations[names.size()].push_back(frame.duration);
+            });
+            std::vector<ProfileStats> res;
+            for (std::size_t i = 0; i < durations.size(); i++) {
+                auto &values = durations[i];
+                if (values.empty())
+                    continue ;
+                std::sort(values.begin(), values.end());
+                ProfileStats stats;
+                stats.name = i < names.size() ? names[i] : "frame";
+                stats.calls = values.size();
+                double total = 0;
+                for (auto value: values)
+                    total += value;
+                const auto ms = [](double ns) { return ns / 1e6; };
+                stats.mean = ms(total / values.size());
+                stats.p50 = ms(values[(values.size() - 1) / 2]);
+                stats.p99 = ms(values[(values.size() - 1) * 99 / 100]);
+                stats.max = ms(values.back());
+                res.push_back(std::move(stats));
+            }
+            return res;
+        }
+
+        // Chrome trace_event JSON, loadable in chrome://tracing or Perfetto :
+        // one complete event per sample, and counters for the churn of each frame.
+        void writeChromeTrace(std::ostream &out) const
+        {
+            const auto escape = [](std::string const &str) {
+                std::string res;
+                for (auto c: str) {
+                    if (c == '"' || c == '\\')
+                        res += '\\';
+                    if (static_cast<unsigned char>(c) >= 0x20)
+                        res += c;
+                }
+                return res;
+            };
+            const auto us = [](std::int64_t ns) { return static_cast<double>(ns) / 1000; };
+            bool first = true;
+            const auto separate = [&out, &first]() {
+                if (!first)
+                    out << ",\n";
+                first = false;
+            };
+            // Microseconds to the nanosecond, however long the process has run.
+            const auto flags = out.flags();
+            const auto precision = out.precision();
+            out << std::fixed << std::setprecision(3);
+            out << "{\"traceEvents\":[\n";
+            eachFrame([&](FrameProfile const &frame) {
+                separate();
+                out << "{\"name\":\"frame " << frame.frame << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":"
+                    << us(frame.start) << ",\"dur\":" << us(frame.duration) << "}";
+                for (auto &sample: frame.samples) {
+                    separate();
+                    out << "{\"name\":\"" << escape(names[sample.name]) << "\",\"cat\":\"system\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                        << sample.thread << ",\"ts\":" << us(sample.start) << ",\"dur\":" << us(sample.duration) << "}";
+                }
+                separate();
+                out << "{\"name\":\"churn\",\"ph\":\"C\",\"pid\":1,\"ts\":" << us(frame.start) << ",\"args\":{"
+                    << "\"entitiesCreated\":" << frame.entitiesCreated
+                    << ",\"entitiesDestroyed\":" << frame.entitiesDestroyed
+                    << ",\"componentsAttached\":" << frame.componentsAttached
+                    << ",\"componentsDetached\":" << frame.componentsDetached
+                    << ",\"eventsSent\":" << frame.eventsSent
+                    << ",\"allocations\":" << frame.allocations << "}}";
+            });
+            out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+            out.flags(flags);
+            out.precision(precision);
+        }
+    };
+}
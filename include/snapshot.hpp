@@ -0,0 +1,352 @@
+#pragma once
+
+# include <mutex>
+# include <string>
+# include <vector>
+# include <cstdint>
+# include <cstring>
+# include <algorithm>
+# include <fstream>
+# include <stdexcept>
+# include <type_traits>
+# include <unordered_map>
+# ifdef _WIN32
+#  include <iterator>
+# else
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+# endif
+# include "utils/types.hpp"
+# include "storage.hpp"
+
+namespace fengin
+{
+    class   Entity;
+    class   EntityManager;
+
+    // Appends plain values to a snapshot buffer. Components that are not
+    // trivially copyable write their fields with a member
+    //     template <typename Archive> void snapshot(Archive &ar) { ar(x, y, target); }
+    // called with a SnapshotWriter when saving and a SnapshotReader when loading.
+    class   SnapshotWriter
+    {
+        std::vector<unsigned char> &out;
+    public:
+        explicit SnapshotWriter(std::vector<unsigned char> &out): out(out) {}
+
+        std::size_t size() const noexcept { return out.size(); }
+
+        void bytes(void const *data, std::size_t n)
+        {
+            auto first = static_cast<unsigned char const *>(data);
+            out.insert(out.end(), first, first + n);
+        }
+
+        // Pads with zeros up to a multiple of alignment.
+        void align(std::size_t alignment)
+        {
+            out.resize((out.size() + alignment - 1) / alignment * alignment, 0);
+        }
+
+        template <typename T>
+        void write(T const &value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written as is");
+            bytes(&value, sizeof(T));
+        }
+
+        void write(std::string const &str)
+        {
+            write(static_cast<std::uint32_t>(str.size()));
+            bytes(str.data(), str.size());
+        }
+
+        template <typename T>
+        void write(std::vector<T> const &values)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only vectors of trivially copyable values can be written");
+            write(static_cast<std::uint64_t>(values.size()));
+            bytes(values.data(), values.size() * sizeof(T));
+        }
+
+        // Overwrites a value written earlier at offset at.
+        template <typename T>
+        void patch(std::size_t at, T const &value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written as is");
+            std::memcpy(out.data() + at, &value, sizeof(T));
+        }
+
+        template <typename ...Ts>
+        void operator()(Ts const &...values)
+        {
+            (write(values), ...);
+        }
+    };
+
+    // Reads a snapshot in place, throwing instead of reading past its end.
+    class   SnapshotReader
+    {
+        unsigned char const *data;
+        std::size_t length;
+        std::size_t pos{0};
+    public:
+        SnapshotReader(void const *data, std::size_t length): data(static_cast<unsigned char const *>(data)), length(length) {}
+
+        std::size_t offset() const noexcept { return pos; }
+
+        // Returns the next n bytes and skips them.
+        unsigned char const *take(std::size_t n)
+        {
+            if (n > length - pos)
+                throw std::runtime_error("Truncated snapshot");
+            auto res = data + pos;
+            pos += n;
+            return res;
+        }
+
+        void align(std::size_t alignment)
+        {
+            take((alignment - pos % alignment) % alignment);
+        }
+
+        void seek(std::size_t at)
+        {
+            if (at > length)
+                throw std::runtime_error("Truncated snapshot");
+            pos = at;
+        }
+
+        template <typename T>
+        void read(T &value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read as is");
+            std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        }
+
+        void read(std::string &str)
+        {
+            std::uint32_t size;
+            read(size);
+            auto first = reinterpret_cast<char const *>(take(size));
+            str.assign(first, size);
+        }
+
+        template <typename T>
+        void read(std::vector<T> &values)
+        {
+            std::uint64_t size;
+            read(size);
+            if (size > (length - pos) / sizeof(T))
+                throw std::runtime_error("Truncated snapshot");
+            values.resize(size);
+            std::memcpy(values.data(), take(size * sizeof(T)), size * sizeof(T));
+        }
+
+        template <typename T>
+        T read()
+        {
+            T value;
+            read(value);
+            return value;
+        }
+
+        template <typename ...Ts>
+        void operator()(Ts &...values)
+        {
+            (read(values), ...);
+        }
+    };
+
+    // Read only view of a whole file, mapped in memory where the platform allows it.
+    class   MappedFile
+    {
+        void const *first{nullptr};
+        std::size_t length{0};
+# ifdef _WIN32
+        std::vector<char> buffer;
+# endif
+    public:
+        explicit MappedFile(std::string const &path)
+        {
+# ifdef _WIN32
+            std::ifstream in(path, std::ios::binary);
+            if (!in)
+                throw std::runtime_error("Cannot open " + path);
+            buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            first = buffer.data();
+            length = buffer.size();
+# else
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("Cannot open " + path);
+            struct stat info;
+            if (::fstat(fd, &info) != 0) {
+                ::close(fd);
+                throw std::runtime_error("Cannot stat " + path);
+            }
+            length = static_cast<std::size_t>(info.st_size);
+            if (length > 0) {
+                auto mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped == MAP_FAILED) {
+                    ::close(fd);
+                    throw std::runtime_error("Cannot map " + path);
+                }
+                first = mapped;
+            }
+            ::close(fd);
+# endif
+        }
+
+        MappedFile(MappedFile const &) = delete;
+        MappedFile &operator=(MappedFile const &) = delete;
+
+        ~MappedFile()
+        {
+# ifndef _WIN32
+            if (first != nullptr)
+                ::munmap(const_cast<void *>(first), length);
+# endif
+        }
+
+        void const *data() const noexcept { return first; }
+        std::size_t size() const noexcept { return length; }
+    };
+
+    // How to save and load the column of a component type, and how to rebuild
+    // an entity type. Snapshots name types, so every type found in a world
+    // must be registered to save it, and again by the process loading it.
+    class   SnapshotRegistry
+    {
+    public:
+        struct  ComponentCodec
+        {
+            std::string name;
+            ComponentId id;
+            // Writes the components of the given entities, in that order.
+            // Given the storage's own entityIds(), copies it page by page.
+            void (*save)(IComponentStorage const &, std::vector<int> const &, SnapshotWriter &);
+            // Attaches a component read from the reader to each entity, given by id and owner.
+            void (*load)(ComponentStore &, std::vector<int> const &, std::vector<Entity *> const &, SnapshotReader &);
+        };
+
+        struct  EntityCodec
+        {
+            std::string name;
+            futils::type_index type;
+            // Builds a default T under the given handle, its constructor attaching
+            // to the given scratch store. See EntityManager::loadSnapshot.
+            Entity *(*build)(EntityManager &, EntityHandle, ComponentStore &);
+        };
+    private:
+        std::mutex lock;
+        std::unordered_map<ComponentId, ComponentCodec> componentsById;
+        std::unordered_map<std::string, ComponentId> componentsByName;
+        std::unordered_map<futils::type_index, EntityCodec> entitiesByType;
+        std::unordered_map<std::string, futils::type_index> entitiesByName;
+
+        template <typename T, typename = void>
+        struct  HasSnapshot : std::false_type {};
+
+        template <typename T>
+        struct  HasSnapshot<T, std::void_t<decltype(std::declval<T &>().snapshot(std::declval<SnapshotWriter &>()))>> : std::true_type {};
+
+        template <typename T>
+        static void saveColumn(IComponentStorage const &base, std::vector<int> const &entityIds, SnapshotWriter &writer)
+        {
+            auto &storage = static_cast<ComponentStorage<T> const &>(base);
+            writer.write(static_cast<std::uint32_t>(sizeof(T)));
+            if constexpr (std::is_trivially_copyable<T>::value) {
+                writer.align(alignof(T));
+                if (&entityIds == &storage.entityIds()) {
+                    const auto count = storage.size();
+                    for (std::size_t base = 0; base < count; base += ComponentStorage<T>::PageSize)
+                        writer.bytes(&storage.at(base), std::min(ComponentStorage<T>::PageSize, count - base) * sizeof(T));
+                } else {
+                    for (auto id: entityIds)
+                        writer.bytes(storage.find(id), sizeof(T));
+                }
+            } else {
+                for (auto id: entityIds)
+                    const_cast<T *>(storage.find(id))->snapshot(writer);
+            }
+        }
+
+        template <typename T>
+        static void loadColumn(ComponentStore &store, std::vector<int> const &entityIds, std::vector<Entity *> const &owners, SnapshotReader &reader)
+        {
+            if (reader.read<std::uint32_t>() != sizeof(T))
+                throw std::runtime_error(std::string("Snapshot column of ") + typeid(T).name() + " has another layout");
+            auto &storage = store.storage<T>();
+            storage.reserve(entityIds.size());
+            if constexpr (std::is_trivially_copyable<T>::value) {
+                reader.align(alignof(T));
+                auto column = reader.take(entityIds.size() * sizeof(T));
+                for (std::size_t i = 0; i < entityIds.size(); i++) {
+                    auto &compo = storage.emplace(entityIds[i], *owners[i]);
+                    std::memcpy(&compo, column + i * sizeof(T), sizeof(T));
+                }
+            } else {
+                for (std::size_t i = 0; i < entityIds.size(); i++) {
+                    auto &compo = storage.emplace(entityIds[i], *owners[i]);
+                    compo.snapshot(reader);
+                    compo.setTypeindex(futils::type<T>::index);
+                    compo.setEntity(*owners[i]);
+                }
+            }
+        }
+    public:
+        static SnapshotRegistry &inst()
+        {
+            static SnapshotRegistry registry;
+            return registry;
+        }
+
+        // name defaults to the compiler's name of T, which only other builds
+        // of the same compiler agree on.
+        template <typename T>
+        void component(std::string const &name = typeid(T).name())
+        {
+            static_assert(std::is_default_constructible<T>::value, "Components saved in snapshots must be default constructible");
+            static_assert(std::is_trivially_copyable<T>::value || HasSnapshot<T>::value,
+                          "Components saved in snapshots must be trivially copyable or have a snapshot(Archive &) member");
+            std::lock_guard<std::mutex> guard(lock);
+            const auto id = ComponentType<T>::id();
+            componentsById[id] = ComponentCodec{name, id, &saveColumn<T>, &loadColumn<T>};
+            componentsByName[name] = id;
+        }
+
+        template <typename T>
+        void entity(std::string const &name = typeid(T).name());
+
+        ComponentCodec const *findComponent(ComponentId id)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = componentsById.find(id);
+            return it == componentsById.end() ? nullptr : &it->second;
+        }
+
+        ComponentCodec const *findComponent(std::string const &name)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = componentsByName.find(name);
+            return it == componentsByName.end() ? nullptr : &componentsById.at(it->second);
+        }
+
+        EntityCodec const *findEntity(futils::type_index type)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = entitiesByType.find(type);
+            return it == entitiesByType.end() ? nullptr : &it->second;
+        }
+
+        EntityCodec const *findEntity(std::string const &name)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = entitiesByName.find(name);
+            return it == entitiesByName.end() ? nullptr : &entitiesByType.at(it->second);
+        }
+    };
+}
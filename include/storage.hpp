@@ -0,0 +1,670 @@
+#pragma once
+
+# include <vector>
+# include <new>
+# include <memory>
+# include <cstdint>
+# include <string>
+# include <typeinfo>
+# include <algorithm>
+# include <bitset>
+# include <mutex>
+# include <atomic>
+# include <stdexcept>
+# include <functional>
+# include <type_traits>
+# include <unordered_map>
+# include "utils/types.hpp"
+# include "handle.hpp"
+# include "pool.hpp"
+
+# ifndef FENGIN_MAX_COMPONENTS
+#  define FENGIN_MAX_COMPONENTS 256
+# endif
+
+namespace fengin
+{
+    class   Entity;
+    class   System;
+
+    using ComponentId = std::uint16_t;
+    static constexpr std::size_t MaxComponents = FENGIN_MAX_COMPONENTS;
+    using ComponentMask = std::bitset<MaxComponents>;
+
+    // Gives every component type a small dense id, in order of first use.
+    // Keyed on futils::type_index so that plugins agree on the ids.
+    class   ComponentRegistry
+    {
+        std::mutex lock;
+        std::unordered_map<futils::type_index, ComponentId> ids;
+    public:
+        static ComponentRegistry &inst()
+        {
+            static ComponentRegistry registry;
+            return registry;
+        }
+
+        ComponentId idOf(futils::type_index index, char const *name)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = ids.find(index);
+            if (it != ids.end())
+                return it->second;
+            if (ids.size() >= MaxComponents)
+                throw std::length_error(std::string("Too many component types, cannot register ") + name + " (see FENGIN_MAX_COMPONENTS)");
+            const auto id = static_cast<ComponentId>(ids.size());
+            ids.emplace(index, id);
+            return id;
+        }
+
+        std::size_t size()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return ids.size();
+        }
+    };
+
+    // Cached dense id of T : the registry is only asked once per type.
+    template <typename T>
+    struct  ComponentType
+    {
+        static ComponentId id()
+        {
+            static const ComponentId value = ComponentRegistry::inst().idOf(futils::type<T>::index, typeid(T).name());
+            return value;
+        }
+    };
+
+    // Change ticks : every EntityManager has a ChangeClock, bumped before each
+    // of its systems runs and at frame boundaries, and its storages stamp
+    // components with the tick of the clock as the touching thread sees it.
+    // Compare them with ChangeTick::newer, which survives the counter wrapping around.
+    struct  ChangeTick
+    {
+        // Stored ticks further behind than MaxAge are brought up to it at least
+        // every CheckInterval ticks, so that none falls half the counter behind
+        // and looks newer again. See EntityManager::checkTicks.
+        static constexpr std::uint32_t MaxAge = 1u << 30;
+        static constexpr std::uint32_t CheckInterval = 1u << 28;
+
+        static bool newer(std::uint32_t tick, std::uint32_t since) noexcept
+        {
+            return static_cast<std::int32_t>(tick - since) > 0;
+        }
+
+        static void clamp(std::uint32_t &tick, std::uint32_t now) noexcept
+        {
+            if (now - tick > MaxAge)
+                tick = now - MaxAge;
+        }
+    };
+
+    // Ticks of one EntityManager, and which of its systems each thread runs.
+    // A thread running none of them, between frames or in a frame of another
+    // manager, sees the latest tick and no system.
+    class   ChangeClock
+    {
+        struct  Running
+        {
+            ChangeClock const *clock{nullptr};
+            System *system{nullptr};
+            std::uint32_t tick{0};
+        };
+
+        std::atomic<std::uint32_t> ticks{0};
+
+        static Running &running() noexcept
+        {
+            static thread_local Running state;
+            return state;
+        }
+    public:
+        // Makes the calling thread run system at tick, until the scope ends.
+        class   Scope
+        {
+            Running saved;
+        public:
+            Scope(ChangeClock const &clock, System *system, std::uint32_t tick) noexcept: saved(running())
+            {
+                running() = {&clock, system, tick};
+            }
+
+            Scope(Scope const &) = delete;
+            Scope &operator=(Scope const &) = delete;
+
+            ~Scope()
+            {
+                running() = saved;
+            }
+        };
+
+        std::uint32_t latest() const noexcept
+        {
+            return ticks.load(std::memory_order_relaxed);
+        }
+
+        std::uint32_t next() noexcept
+        {
+            return ticks.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+
+        std::uint32_t now() const noexcept
+        {
+            auto const &state = running();
+            return state.clock == this ? state.tick : latest();
+        }
+
+        System *system() const noexcept
+        {
+            auto const &state = running();
+            return state.clock == this ? state.system : nullptr;
+        }
+    };
+
+    struct  ComponentTicks
+    {
+        std::uint32_t added{0};
+        std::uint32_t changed{0};
+    };
+
+    // Maps an entity id to a dense index. Allocated by pages so that ids far
+    // apart do not cost memory for every id in between.
+    class   SparseIndex
+    {
+    public:
+        static constexpr std::uint32_t npos = ~std::uint32_t(0);
+    private:
+        static constexpr std::size_t PageSize = 4096;
+        std::vector<futils::UP<std::uint32_t[]>> pages;
+    public:
+        std::uint32_t find(std::size_t id) const noexcept
+        {
+            const auto page = id / PageSize;
+            if (page >= pages.size() || !pages[page])
+                return npos;
+            return pages[page][id % PageSize];
+        }
+
+        void set(std::size_t id, std::uint32_t dense)
+        {
+            const auto page = id / PageSize;
+            if (page >= pages.size())
+                pages.resize(page + 1);
+            if (!pages[page]) {
+                pages[page].reset(new std::uint32_t[PageSize]);
+                std::fill_n(pages[page].get(), PageSize, npos);
+            }
+            pages[page][id % PageSize] = dense;
+        }
+
+        void reset(std::size_t id) noexcept
+        {
+            const auto page = id / PageSize;
+            if (page < pages.size() && pages[page])
+                pages[page][id % PageSize] = npos;
+        }
+    };
+
+    class   IComponentStorage
+    {
+    protected:
+        std::vector<int> ids;
+        std::vector<Entity *> owners;
+        std::vector<ComponentTicks> ticks;
+        // Entity ids whose component was removed, with the tick of removal.
+        std::vector<std::pair<int, std::uint32_t>> removals;
+        // Latest tick of the removals dropped while still unread, see pruneRemovals.
+        std::uint32_t forgotten{0};
+        std::uint64_t attached{0};
+        // Tick of the latest attach, modification or removal, whichever thread did it.
+        std::atomic<std::uint32_t> latest{0};
+        // Clock of the owning manager. Scratch storages have none and stamp 0.
+        ChangeClock const *clock;
+
+        std::uint32_t now() const noexcept
+        {
+            return clock != nullptr ? clock->now() : 0;
+        }
+
+        // Only written once per tick, so that threads flagging components of
+        // the same storage do not fight over its cache line.
+        void stamp(std::uint32_t now) noexcept
+        {
+            if (latest.load(std::memory_order_relaxed) != now)
+                latest.store(now, std::memory_order_relaxed);
+        }
+
+        void logRemoval(int entityId)
+        {
+            const auto tick = now();
+            removals.emplace_back(entityId, tick);
+            stamp(tick);
+        }
+    public:
+        explicit IComponentStorage(ChangeClock const *clock): clock(clock) {}
+        virtual ~IComponentStorage() {}
+        virtual bool contains(int entityId) const noexcept = 0;
+        virtual bool remove(int entityId) = 0;
+        virtual std::size_t size() const noexcept = 0;
+        virtual void clear() = 0;
+
+        // Owner of every component, in dense order.
+        std::vector<int> const &entityIds() const noexcept { return ids; }
+        std::vector<Entity *> const &entities() const noexcept { return owners; }
+        std::vector<ComponentTicks> const &changeTicks() const noexcept { return ticks; }
+
+        // Components added, and removed, since the storage was built.
+        std::uint64_t attachments() const noexcept { return attached; }
+        std::uint64_t detachments() const noexcept { return attached - size(); }
+
+        // Flags the component at dense as modified.
+        void markChanged(std::size_t dense) noexcept
+        {
+            ticks[dense].changed = now();
+            stamp(ticks[dense].changed);
+        }
+
+        std::uint32_t lastChange() const noexcept
+        {
+            return latest.load(std::memory_order_relaxed);
+        }
+
+        // Returns false if the entity has no such component.
+        virtual bool touch(int entityId) noexcept = 0;
+        virtual bool addedSince(int entityId, std::uint32_t since) const noexcept = 0;
+        // Added or modified.
+        virtual bool changedSince(int entityId, std::uint32_t since) const noexcept = 0;
+
+        // Calls fun(int entityId) for every removal after since, oldest first.
+        // Returns false if some of them were forgotten.
+        template <typename Fun>
+        bool eachRemoved(std::uint32_t since, Fun &&fun) const
+        {
+            for (auto &removal: removals) {
+                if (ChangeTick::newer(removal.second, since))
+                    fun(removal.first);
+            }
+            return !ChangeTick::newer(forgotten, since);
+        }
+
+        // See ChangeTick::clamp.
+        void clampTicks(std::uint32_t now) noexcept
+        {
+            for (auto &tick: ticks) {
+                ChangeTick::clamp(tick.added, now);
+                ChangeTick::clamp(tick.changed, now);
+            }
+            for (auto &removal: removals)
+                ChangeTick::clamp(removal.second, now);
+            ChangeTick::clamp(forgotten, now);
+            auto last = latest.load(std::memory_order_relaxed);
+            ChangeTick::clamp(last, now);
+            latest.store(last, std::memory_order_relaxed);
+        }
+
+        // Forgets removals no one can ask about anymore. Past as many removals
+        // as there are components, or MinRemovals, the oldest are forgotten
+        // even if unread : rescanning the storage is cheaper than keeping them
+        // for a system sleeping or running at a slow rate.
+        static constexpr std::size_t MinRemovals = 1024;
+
+        void pruneRemovals(std::uint32_t until)
+        {
+            removals.erase(std::remove_if(removals.begin(), removals.end(), [until](auto const &removal) {
+                return !ChangeTick::newer(removal.second, until);
+            }), removals.end());
+            const auto limit = std::max(MinRemovals, size());
+            if (removals.size() <= limit)
+                return ;
+            const auto dropped = removals.size() - limit;
+            for (std::size_t i = 0; i < dropped; i++) {
+                if (ChangeTick::newer(removals[i].second, forgotten))
+                    forgotten = removals[i].second;
+            }
+            removals.erase(removals.begin(), removals.begin() + static_cast<std::ptrdiff_t>(dropped));
+        }
+    };
+
+    // Owns every component of type T by value, packed in a dense array.
+    // The array is split in fixed-size pages so growing it never moves live
+    // components. Removing a component moves the last one into the hole, so a
+    // reference to a component is only valid until the next detach of that type:
+    // keep a ComponentHandle to refer to it across frames.
+    template <typename T>
+    class   ComponentStorage : public IComponentStorage
+    {
+        static constexpr std::size_t CacheLine = 64;
+        static constexpr std::size_t PageBytes = 16 * 1024;
+    public:
+        static constexpr std::size_t PageSize = sizeof(T) >= PageBytes ? 1 : PageBytes / sizeof(T);
+    private:
+        struct alignas(alignof(T) > CacheLine ? alignof(T) : CacheLine) Page
+        {
+            unsigned char bytes[sizeof(T) * PageSize];
+        };
+
+        std::vector<futils::UP<Page>> pages;
+        SparseIndex sparse;
+        std::size_t count{0};
+
+        T *slot(std::size_t dense) const noexcept
+        {
+            return reinterpret_cast<T *>(pages[dense / PageSize]->bytes) + dense % PageSize;
+        }
+    public:
+        class   iterator
+        {
+            ComponentStorage const *storage;
+            std::size_t index;
+        public:
+            iterator(ComponentStorage const *storage, std::size_t index): storage(storage), index(index) {}
+            T &operator*() const { return storage->at(index); }
+            T *operator->() const { return &storage->at(index); }
+            iterator &operator++() { index++; return *this; }
+            bool operator==(iterator const &other) const { return index == other.index; }
+            bool operator!=(iterator const &other) const { return index != other.index; }
+        };
+
+        explicit ComponentStorage(ChangeClock const *clock = nullptr): IComponentStorage(clock) {}
+        ComponentStorage(ComponentStorage const &) = delete;
+        ComponentStorage &operator=(ComponentStorage const &) = delete;
+        ~ComponentStorage() override
+        {
+            clear();
+        }
+
+        template <typename ...Args>
+        T &emplace(int entityId, Entity &owner, Args &&...args)
+        {
+            if (contains(entityId))
+                throw std::runtime_error(std::string("Entity ") + std::to_string(entityId) + " already owns a " + typeid(T).name());
+            if (count == pages.size() * PageSize) {
+                pages.emplace_back(new Page);
+                MemoryStats::allocated();
+            }
+            T *compo;
+            if constexpr (std::is_constructible<T, Args &&...>::value)
+                compo = new (slot(count)) T(std::forward<Args>(args)...);
+            else
+                compo = new (slot(count)) T{std::forward<Args>(args)...};      // Aggregates.
+            const auto tick = now();
+            ids.push_back(entityId);
+            owners.push_back(&owner);
+            ticks.push_back({tick, tick});
+            stamp(tick);
+            attached++;
+            sparse.set(entityId, static_cast<std::uint32_t>(count));
+            count++;
+            return *compo;
+        }
+
+        // Makes room for n more components at once.
+        void reserve(std::size_t n)
+        {
+            while (pages.size() * PageSize < count + n) {
+                pages.emplace_back(new Page);
+                MemoryStats::allocated();
+            }
+            ids.reserve(count + n);
+            owners.reserve(count + n);
+            ticks.reserve(count + n);
+        }
+
+        bool remove(int entityId) override
+        {
+            const auto dense = sparse.find(entityId);
+            if (dense == SparseIndex::npos)
+                return false;
+            const auto last = count - 1;
+            slot(dense)->~T();
+            if (dense != last) {
+                new (slot(dense)) T(std::move(*slot(last)));
+                slot(last)->~T();
+                ids[dense] = ids[last];
+                owners[dense] = owners[last];
+                ticks[dense] = ticks[last];
+                sparse.set(ids[dense], dense);
+            }
+            ids.pop_back();
+            owners.pop_back();
+            ticks.pop_back();
+            sparse.reset(entityId);
+            logRemoval(entityId);
+            count--;
+            return true;
+        }
+
+        void clear() override
+        {
+            if constexpr (!std::is_trivially_destructible<T>::value) {
+                for (std::size_t i = 0; i < count; i++)
+                    slot(i)->~T();
+            }
+            for (auto id: ids) {
+                sparse.reset(id);
+                logRemoval(id);
+            }
+            ids.clear();
+            owners.clear();
+            ticks.clear();
+            count = 0;
+        }
+
+        bool contains(int entityId) const noexcept override
+        {
+            return sparse.find(entityId) != SparseIndex::npos;
+        }
+
+        std::size_t size() const noexcept override
+        {
+            return count;
+        }
+
+        bool touch(int entityId) noexcept override
+        {
+            const auto dense = sparse.find(entityId);
+            if (dense == SparseIndex::npos)
+                return false;
+            markChanged(dense);
+            return true;
+        }
+
+        bool addedSince(int entityId, std::uint32_t since) const noexcept override
+        {
+            const auto dense = sparse.find(entityId);
+            return dense != SparseIndex::npos && ChangeTick::newer(ticks[dense].added, since);
+        }
+
+        bool changedSince(int entityId, std::uint32_t since) const noexcept override
+        {
+            const auto dense = sparse.find(entityId);
+            return dense != SparseIndex::npos && ChangeTick::newer(ticks[dense].changed, since);
+        }
+
+        T *find(int entityId) const noexcept
+        {
+            const auto dense = sparse.find(entityId);
+            if (dense == SparseIndex::npos)
+                return nullptr;
+            return slot(dense);
+        }
+
+        T &get(int entityId) const
+        {
+            auto compo = find(entityId);
+            if (compo == nullptr)
+                throw std::runtime_error("Entity " + std::to_string(entityId) + " does not have requested component : " + std::string(typeid(T).name()));
+            return *compo;
+        }
+
+        // Dense accessors, valid for index < size().
+        T &at(std::size_t dense) const noexcept { return *slot(dense); }
+        int idAt(std::size_t dense) const noexcept { return ids[dense]; }
+        Entity &entityAt(std::size_t dense) const noexcept { return *owners[dense]; }
+
+        // Owner of the component of entityId, or nullptr.
+        Entity *entityOf(int entityId) const noexcept
+        {
+            const auto dense = sparse.find(entityId);
+            return dense == SparseIndex::npos ? nullptr : owners[dense];
+        }
+
+        // Owner of a component of this storage, found from its address. Plain
+        // data components do not know their entity, see IsComponent.
+        Entity *ownerOf(T const &compo) const noexcept
+        {
+            for (std::size_t page = 0; page < pages.size(); page++) {
+                auto first = reinterpret_cast<T const *>(pages[page]->bytes);
+                if (!std::less_equal<T const *>()(first, &compo) || !std::less<T const *>()(&compo, first + PageSize))
+                    continue ;
+                const auto dense = page * PageSize + static_cast<std::size_t>(&compo - first);
+                return dense < count ? owners[dense] : nullptr;
+            }
+            return nullptr;
+        }
+
+        // Calls fun(T &, Entity &) on every component, one contiguous page at a time.
+        template <typename Fun>
+        void each(Fun &&fun) const
+        {
+            for (std::size_t base = 0; base < count; base += PageSize) {
+                auto page = reinterpret_cast<T *>(pages[base / PageSize]->bytes);
+                const auto end = std::min(PageSize, count - base);
+                for (std::size_t i = 0; i < end; i++)
+                    fun(page[i], *owners[base + i]);
+            }
+        }
+
+        iterator begin() const { return iterator(this, 0); }
+        iterator end() const { return iterator(this, count); }
+    };
+
+    // Refers to the component of type T owned by an entity. Unlike a raw
+    // reference, it stays valid when the storage moves the component around.
+    // Once the entity is destroyed it refers to nothing, even after its id is
+    // given to another entity.
+    template <typename T>
+    class   ComponentHandle
+    {
+        ComponentStorage<T> *storage{nullptr};
+        EntityHandle entity;
+    public:
+        ComponentHandle() = default;
+        ComponentHandle(ComponentStorage<T> &storage, EntityHandle entity): storage(&storage), entity(entity) {}
+
+        // Defined with Entity, in ecs.hpp.
+        T *get() const noexcept;
+        T *operator->() const noexcept { return get(); }
+        T &operator*() const
+        {
+            auto compo = get();
+            if (compo == nullptr)
+                throw std::runtime_error("Entity " + std::to_string(entity.index) + " does not have requested component : " + std::string(typeid(T).name()));
+            return *compo;
+        }
+        explicit operator bool() const noexcept { return get() != nullptr; }
+        int getEntityId() const noexcept { return static_cast<int>(entity.index); }
+        EntityHandle getEntity() const noexcept { return entity; }
+    };
+
+    // Every component storage of an EntityManager, indexed by ComponentId.
+    class   ComponentStore
+    {
+        std::vector<futils::UP<IComponentStorage>> storages;
+        ChangeClock const *clock;
+    public:
+        explicit ComponentStore(ChangeClock const *clock = nullptr): clock(clock) {}
+
+        template <typename T>
+        ComponentStorage<T> &storage()
+        {
+            const auto id = ComponentType<T>::id();
+            if (id >= storages.size())
+                storages.resize(id + 1);
+            if (!storages[id])
+                storages[id] = std::make_unique<ComponentStorage<T>>(clock);
+            return static_cast<ComponentStorage<T> &>(*storages[id]);
+        }
+
+        template <typename T>
+        ComponentStorage<T> *find() const noexcept
+        {
+            const auto id = ComponentType<T>::id();
+            if (id >= storages.size())
+                return nullptr;
+            return static_cast<ComponentStorage<T> *>(storages[id].get());
+        }
+
+        template <typename T>
+        T *find(int entityId) const noexcept
+        {
+            auto storage = find<T>();
+            return storage ? storage->find(entityId) : nullptr;
+        }
+
+        void removeAll(int entityId)
+        {
+            for (auto &storage: storages) {
+                if (storage)
+                    storage->remove(entityId);
+            }
+        }
+
+        // Components added, and removed, over every storage.
+        std::uint64_t attachments() const noexcept
+        {
+            std::uint64_t total = 0;
+            for (auto &storage: storages)
+                total += storage ? storage->attachments() : 0;
+            return total;
+        }
+
+        std::uint64_t detachments() const noexcept
+        {
+            std::uint64_t total = 0;
+            for (auto &storage: storages)
+                total += storage ? storage->detachments() : 0;
+            return total;
+        }
+
+        IComponentStorage const *find(ComponentId id) const noexcept
+        {
+            return id < storages.size() ? storages[id].get() : nullptr;
+        }
+
+        // Calls fun(ComponentId, IComponentStorage const &) on every storage holding components.
+        template <typename Fun>
+        void each(Fun &&fun) const
+        {
+            for (std::size_t id = 0; id < storages.size(); id++) {
+                if (storages[id] && storages[id]->size() > 0)
+                    fun(static_cast<ComponentId>(id), *storages[id]);
+            }
+        }
+
+        void pruneRemovals(std::uint32_t until)
+        {
+            for (auto &storage: storages) {
+                if (storage)
+                    storage->pruneRemovals(until);
+            }
+        }
+
+        void clampTicks(std::uint32_t now) noexcept
+        {
+            for (auto &storage: storages) {
+                if (storage)
+                    storage->clampTicks(now);
+            }
+        }
+
+        // Only visits the storages flagged in mask.
+        void removeAll(int entityId, ComponentMask const &mask)
+        {
+            for (std::size_t id = 0; id < storages.size(); id++) {
+                if (mask.test(id) && storages[id])
+                    storages[id]->remove(entityId);
+            }
+        }
+    };
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+# include <deque>
+# include <mutex>
+# include <atomic>
+# include <thread>
+# include <vector>
+# include <memory>
+# include <exception>
+# include <functional>
+# include <condition_variable>
+# include "utils/types.hpp"
+
+namespace fengin
+{
+    class   ThreadPool;
+
+    // Tasks submitted together, waited on together. The first exception thrown
+    // by one of them is rethrown by ThreadPool::wait.
+    class   TaskGroup
+    {
+        friend class ThreadPool;
+        std::atomic<int> pending{0};
+        std::mutex lock;
+        std::exception_ptr error{nullptr};
+    public:
+        bool done() const noexcept
+        {
+            return pending.load(std::memory_order_acquire) == 0;
+        }
+    };
+
+    // Work-stealing pool : each worker pops the newest task of its own deque and
+    // steals the oldest task of the others when it runs dry. Tasks submitted
+    // from outside the pool go through a shared queue. A thread waiting on a
+    // group runs tasks in the meantime, so tasks may wait on sub-tasks.
+    class   ThreadPool
+    {
+        using Task = std::function<void()>;
+
+        struct  Queue
+        {
+            std::mutex lock;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<futils::UP<Queue>> queues;
+        Queue shared;
+        std::vector<std::thread> workers;
+        std::mutex sleepLock;
+        std::condition_variable wakeUp;
+        std::atomic<int> queued{0};
+        std::atomic<bool> stopping{false};
+
+        static ThreadPool *&currentPool()
+        {
+            static thread_local ThreadPool *pool{nullptr};
+            return pool;
+        }
+
+        static std::size_t &currentIndex()
+        {
+            static thread_local std::size_t index{0};
+            return index;
+        }
+
+        bool popBack(Queue &queue, Task &task)
+        {
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (queue.tasks.empty())
+                return false;
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+
+        bool popFront(Queue &queue, Task &task)
+        {
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (queue.tasks.empty())
+                return false;
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+
+        bool next(Task &task)
+        {
+            const bool inPool = currentPool() == this;
+            const auto self = currentIndex();
+            if (inPool && popBack(*queues[self], task))
+                return true;
+            if (popFront(shared, task))
+                return true;
+            for (std::size_t i = 1; i <= queues.size(); i++) {
+                const auto victim = (self + i) % queues.size();
+                if (popFront(*queues[victim], task))
+                    return true;
+            }
+            return false;
+        }
+
+        bool runOne()
+        {
+            Task task;
+            if (!next(task))
+                return false;
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            task();
+            return true;
+        }
+
+        void work(std::size_t index)
+        {
+            currentPool() = this;
+            currentIndex() = index;
+            while (!stopping.load(std::memory_order_acquire)) {
+                if (runOne())
+                    continue ;
+                std::unique_lock<std::mutex> guard(sleepLock);
+                wakeUp.wait(guard, [this]() {
+                    return stopping.load(std::memory_order_acquire) || queued.load(std::memory_order_acquire) > 0;
+                });
+            }
+        }
+
+        void push(Task task)
+        {
+            auto &queue = currentPool() == this ? *queues[currentIndex()] : shared;
+            {
+                std::lock_guard<std::mutex> guard(queue.lock);
+                queue.tasks.push_back(std::move(task));
+            }
+            {
+                std::lock_guard<std::mutex> guard(sleepLock);
+                queued.fetch_add(1, std::memory_order_release);
+            }
+            wakeUp.notify_one();
+        }
+    public:
+        explicit ThreadPool(unsigned int threads = std::thread::hardware_concurrency())
+        {
+            if (threads == 0)
+                threads = 1;
+            for (unsigned int i = 0; i < threads; i++)
+                queues.push_back(std::make_unique<Queue>());
+            for (unsigned int i = 0; i < threads; i++)
+                workers.emplace_back([this, i]() { work(i); });
+        }
+
+        ThreadPool(ThreadPool const &) = delete;
+        ThreadPool &operator=(ThreadPool const &) = delete;
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> guard(sleepLock);
+                stopping.store(true, std::memory_order_release);
+            }
+            wakeUp.notify_all();
+            for (auto &worker: workers)
+                worker.join();
+        }
+
+        std::size_t size() const noexcept
+        {
+            return workers.size();
+        }
+
+        void run(TaskGroup &group, Task task)
+        {
+            group.pending.fetch_add(1, std::memory_order_relaxed);
+            push([&group, task = std::move(task)]() {
+                try {
+                    task();
+                } catch (...) {
+                    std::lock_guard<std::mutex> guard(group.lock);
+                    if (!group.error)
+                        group.error = std::current_exception();
+                }
+                group.pending.fetch_sub(1, std::memory_order_acq_rel);
+            });
+        }
+
+        // Blocks until every task of the group ran, running tasks meanwhile.
+        void wait(TaskGroup &group)
+        {
+            while (!group.done()) {
+                if (!runOne())
+                    std::this_thread::yield();
+            }
+            std::lock_guard<std::mutex> guard(group.lock);
+            if (group.error) {
+                auto error = group.error;
+                group.error = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+    };
+}
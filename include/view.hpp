@@ -0,0 +1,191 @@
+#pragma once
+
+# include <tuple>
+# include <utility>
+# include <numeric>
+# include "storage.hpp"
+# include "threadpool.hpp"
+
+namespace fengin
+{
+    // Lazy range over the entities owning every component in Ts.
+    // It walks the smallest of the storages and looks the others up by entity
+    // id, so it never allocates. Attaching, detaching or destroying while
+    // iterating is not supported.
+    template <typename ...Ts>
+    class   View
+    {
+        static_assert(sizeof...(Ts) > 0, "Error : View needs at least one component type");
+        using Storages = std::tuple<ComponentStorage<Ts> *...>;
+        using Indices = std::index_sequence_for<Ts...>;
+
+        Storages storages;
+        IComponentStorage const *driver{nullptr};
+        // Layout of the driver : elements per page, and per 64 bytes aligned block.
+        std::size_t driverPage{1};
+        std::size_t driverGranule{1};
+
+        template <typename T>
+        void elect(ComponentStorage<T> const *storage)
+        {
+            if (driver != nullptr && storage->size() >= driver->size())
+                return ;
+            driver = storage;
+            driverPage = ComponentStorage<T>::PageSize;
+            driverGranule = 64 / std::gcd(std::size_t(64), sizeof(T));
+        }
+
+        template <std::size_t ...I>
+        bool match(int id, std::index_sequence<I...>) const noexcept
+        {
+            return (std::get<I>(storages)->contains(id) && ...);
+        }
+
+        template <std::size_t ...I>
+        bool changed(int id, std::uint32_t since, std::index_sequence<I...>) const noexcept
+        {
+            return (std::get<I>(storages)->changedSince(id, since) || ...);
+        }
+
+        template <std::size_t ...I>
+        bool added(int id, std::uint32_t since, std::index_sequence<I...>) const noexcept
+        {
+            return (std::get<I>(storages)->addedSince(id, since) || ...);
+        }
+
+        template <typename Fun, std::size_t ...I>
+        void call(Fun &fun, Entity &entity, int id, std::index_sequence<I...>) const
+        {
+            fun(entity, *std::get<I>(storages)->find(id)...);
+        }
+
+        template <std::size_t ...I>
+        std::tuple<Entity &, Ts &...> build(Entity &entity, int id, std::index_sequence<I...>) const
+        {
+            return std::tuple<Entity &, Ts &...>(entity, *std::get<I>(storages)->find(id)...);
+        }
+    public:
+        class   iterator
+        {
+            View const *view;
+            std::size_t index;
+
+            void skip()
+            {
+                auto &ids = view->driver->entityIds();
+                while (index < ids.size() && !view->match(ids[index], Indices{}))
+                    index++;
+            }
+        public:
+            iterator(View const *view, std::size_t index): view(view), index(index) { if (view->driver) skip(); }
+            std::tuple<Entity &, Ts &...> operator*() const
+            {
+                return view->build(*view->driver->entities()[index], view->driver->entityIds()[index], Indices{});
+            }
+            iterator &operator++() { index++; skip(); return *this; }
+            bool operator==(iterator const &other) const { return index == other.index; }
+            bool operator!=(iterator const &other) const { return index != other.index; }
+        };
+
+        explicit View(ComponentStorage<Ts> *...storages): storages(storages...)
+        {
+            if (((storages == nullptr) || ...))
+                return ;
+            (elect(storages), ...);
+        }
+
+        // Calls fun(Entity &, Ts &...) for every matching entity.
+        template <typename Fun>
+        void each(Fun &&fun) const
+        {
+            if (driver != nullptr)
+                each(fun, 0, driver->size());
+        }
+
+        // Same, restricted to the entities at [begin, end) in the driver storage.
+        template <typename Fun>
+        void each(Fun &fun, std::size_t begin, std::size_t end) const
+        {
+            auto &ids = driver->entityIds();
+            auto &owners = driver->entities();
+            for (std::size_t i = begin; i < end; i++) {
+                if (match(ids[i], Indices{}))
+                    call(fun, *owners[i], ids[i], Indices{});
+            }
+        }
+
+        // Same as each, restricted to the entities where one of Ts at least was
+        // attached or modified after the tick since. Only the change ticks of
+        // the skipped entities are read, not their components.
+        template <typename Fun>
+        void eachChanged(std::uint32_t since, Fun &&fun) const
+        {
+            if (driver == nullptr)
+                return ;
+            auto &ids = driver->entityIds();
+            auto &owners = driver->entities();
+            for (std::size_t i = 0; i < ids.size(); i++) {
+                if (changed(ids[i], since, Indices{}) && match(ids[i], Indices{}))
+                    call(fun, *owners[i], ids[i], Indices{});
+            }
+        }
+
+        // Same as each, restricted to the entities where one of Ts at least was
+        // attached after the tick since.
+        template <typename Fun>
+        void eachAdded(std::uint32_t since, Fun &&fun) const
+        {
+            if (driver == nullptr)
+                return ;
+            auto &ids = driver->entityIds();
+            auto &owners = driver->entities();
+            for (std::size_t i = 0; i < ids.size(); i++) {
+                if (added(ids[i], since, Indices{}) && match(ids[i], Indices{}))
+                    call(fun, *owners[i], ids[i], Indices{});
+            }
+        }
+
+        // Calls fun(Entity &, Ts &...) from the threads of pool, chunk entities
+        // at a time. Chunks are cut the same way whatever the number of threads :
+        // chunk is rounded up to whole cache lines of the driver storage and a
+        // chunk never crosses one of its pages. fun must only touch the entity
+        // it is given. Runs on the caller when pool is null or there is a single chunk.
+        template <typename Fun>
+        void parallelEach(ThreadPool *pool, Fun const &fun, std::size_t chunk = 1024) const
+        {
+            if (driver == nullptr)
+                return ;
+            chunk = std::max(driverGranule, (chunk + driverGranule - 1) / driverGranule * driverGranule);
+            const auto total = driver->size();
+            if (pool == nullptr || (total <= chunk && total <= driverPage)) {
+                each(fun);
+                return ;
+            }
+            TaskGroup group;
+            for (std::size_t page = 0; page < total; page += driverPage) {
+                const auto pageEnd = std::min(page + driverPage, total);
+                for (std::size_t begin = page; begin < pageEnd; begin += chunk) {
+                    const auto end = std::min(begin + chunk, pageEnd);
+                    pool->run(group, [this, &fun, begin, end]() {
+                        each(fun, begin, end);
+                    });
+                }
+            }
+            pool->wait(group);
+        }
+
+        // Upper bound of the number of matching entities.
+        std::size_t sizeHint() const noexcept
+        {
+            return driver ? driver->size() : 0;
+        }
+
+        bool empty() const
+        {
+            return begin() == end();
+        }
+
+        iterator begin() const { return iterator(this, 0); }
+        iterator end() const { return iterator(this, driver ? driver->size() : 0); }
+    };
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+# include <chrono>
+# include <cstdint>
+# include <algorithm>
+# include "utils/types.hpp"
+# include "ecs.hpp"
+
+namespace fengin
+{
+    // Pacing of the fixed timestep loop, the same for every world.
+    struct  FixedStep
+    {
+        std::chrono::steady_clock::duration step;
+        std::chrono::steady_clock::duration framePeriod;    // Between per frame passes.
+        std::chrono::steady_clock::duration budget;         // Work allowed per iteration. Zero : unbounded.
+        float stepSeconds;
+        unsigned int maxTicks;
+    };
+
+    // One isolated simulation : its own EntityManager, mediator and system
+    // instances. The worlds of a FenginCore only share the code of the plugins
+    // and the thread pool, so that each one can run its frames on any thread,
+    // though never on two at once.
+    class   World
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+    private:
+        futils::UP<EventManager> events;
+        futils::UP<EntityManager> manager;
+        std::size_t index;
+        bool stopped{false};
+        std::uint64_t frames{0};
+        std::uint64_t overruns{0};
+        Clock::duration cost{0};
+
+        // Fixed loop state, kept between iterations.
+        Clock::duration accumulator{0};
+        Clock::time_point lastFrame{Clock::now()};
+        Clock::time_point deadline{Clock::now()};
+
+        void account(Clock::time_point start, Clock::duration budget)
+        {
+            cost = Clock::now() - start;
+            if (budget > Clock::duration::zero() && cost > budget)
+                overruns++;
+        }
+    public:
+        explicit World(std::size_t index = 0): events(std::make_unique<EventManager>()),
+                                               manager(std::make_unique<EntityManager>()), index(index)
+        {
+            manager->provideEventManager(*events);
+        }
+
+        World(World const &) = delete;
+        World &operator=(World const &) = delete;
+
+        EntityManager &getManager() const noexcept { return *manager; }
+        EventManager &getEvents() const noexcept { return *events; }
+        std::size_t getIndex() const noexcept { return index; }
+
+        bool isRunning() const
+        {
+            return !stopped && manager->getNumberOfSystems() > 0;
+        }
+
+        void stop() noexcept
+        {
+            stopped = true;
+        }
+
+        // Frames of the free loop, or ticks of the fixed one, run so far.
+        std::uint64_t getFrames() const noexcept { return frames; }
+        // Iterations whose work took longer than the budget.
+        std::uint64_t getOverruns() const noexcept { return overruns; }
+        // Work of the last iteration.
+        Clock::duration getLastCost() const noexcept { return cost; }
+        // When the fixed loop needs this world to run again.
+        Clock::time_point getDeadline() const noexcept { return deadline; }
+
+        // One frame of the free loop.
+        void runFree(Clock::duration budget = Clock::duration::zero())
+        {
+            const auto start = Clock::now();
+            if (manager->run() != 0)
+                stopped = true;
+            frames++;
+            account(start, budget);
+        }
+
+        // One iteration of the fixed loop, elapsed after the previous one : the
+        // ticks due, as many as maxTicks and the budget allow, then the per
+        // frame pass. Ticks left over are dropped, so that a late world does
+        // not fall further behind.
+        void runFixed(Clock::time_point now, Clock::duration elapsed, FixedStep const &pace)
+        {
+            const auto start = Clock::now();
+            accumulator += elapsed;
+            for (unsigned int ticks = 0; accumulator >= pace.step && ticks < pace.maxTicks && isRunning(); ticks++) {
+                if (manager->run(pace.stepSeconds, RunPass::Fixed) != 0) {
+                    stopped = true;
+                    return ;
+                }
+                accumulator -= pace.step;
+                frames++;
+                if (pace.budget > Clock::duration::zero() && Clock::now() - start >= pace.budget)
+                    break ;
+            }
+            if (accumulator >= pace.step && isRunning()) {
+                FENGIN_WARNING("[world ", index, "] Running late, dropped ", accumulator / pace.step, " ticks.");
+                accumulator %= pace.step;
+            }
+            deadline = now + (pace.step - accumulator);
+            if (manager->hasPerFrameSystems()) {
+                manager->setInterpolation(std::chrono::duration<float>(accumulator) / std::chrono::duration<float>(pace.step));
+                const auto frameTime = Clock::now();
+                if (manager->run(std::chrono::duration<float>(frameTime - lastFrame).count(), RunPass::Variable) != 0)
+                    stopped = true;
+                lastFrame = frameTime;
+                deadline = std::min(deadline, lastFrame + pace.framePeriod);
+            }
+            account(start, pace.budget);
+        }
+    };
+}
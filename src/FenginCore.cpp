@@ -3,8 +3,11 @@
 //
 
 # include <string>
+# include <chrono>
+# include <thread>
+# include <cmath>
+# include <unordered_set>
 # include <iostream>
-# include <experimental/filesystem>
 # include "FenginCore.hpp"
 # include "utils/sigCatch.hpp"
 # include "utils/goToBinDir.hpp"
@@ -15,6 +18,20 @@ extern "C" fengin::FenginCore *FenginCore(std::string const &execPath) {
 
 static bool interrupt = false;
 
+using Clock = std::chrono::steady_clock;
+
+// Sleeps most of the way, then yields until deadline : sleeping alone
+// overshoots by up to the scheduler's granularity.
+static void sleepUntil(Clock::time_point deadline)
+{
+    constexpr auto margin = std::chrono::milliseconds(1);
+    const auto now = Clock::now();
+    if (deadline - now > margin)
+        std::this_thread::sleep_for(deadline - now - margin);
+    while (Clock::now() < deadline)
+        std::this_thread::yield();
+}
+
 void onSigint(int)
 {
   std::cout << "Interrupt signal received. Shutting down." << std::endl;
@@ -25,50 +42,195 @@ namespace fengin {
     FenginCore::FenginCore(std::string const &arg0){
         futils::goToBinDir(arg0);
 
-        core = std::make_unique<EntityManager>();
-        events = std::make_unique<EventManager >();
-        core->provideEventManager(*events);
+        worlds.push_back(std::make_unique<World>(0));
         futils::SigHandler &sig = futils::SigHandler::inst();
         sig.set(SIGINT, onSigint);
     }
 
-    void fengin::FenginCore::loadSystemDir(std::string const &path, bool recursive, bool log, bool loadSymlinks)
+    void fengin::FenginCore::collectSystemDir(std::string const &path, bool recursive, bool log, bool loadSymlinks,
+                                              std::vector<PluginManifest::Entry *> &libraries)
     {
-        std::cout << "Loading all systems in " << path << std::endl;
-        const auto fsPath = std::experimental::filesystem::path(path);
-        for (auto & p : std::experimental::filesystem::directory_iterator(fsPath)) {
+        for (auto &entry : manifest.scan(path)) {
             if (log)
-                std::cout << "-> Loading " << p << " from " << path << std::endl;
-            if (recursive && std::experimental::filesystem::is_directory(p.path())) {
+                FENGIN_INFO("-> Loading ", entry.path, " from ", path);
+            if (entry.directory) {
+                if (!recursive)
+                    continue ;
                 if (log)
-                    std::cout << "--> Loading directory " << p.path() << std::endl;
-                loadSystemDir(p.path(), recursive, log, loadSymlinks);
+                    FENGIN_INFO("--> Loading directory ", entry.path);
+                collectSystemDir(entry.path, recursive, log, loadSymlinks, libraries);
+            } else if (loadSymlinks || !entry.symlink)
+                libraries.push_back(&entry);
+        }
+    }
+
+    // Libraries are opened together, then their systems are initialized in
+    // path order. Those the manifest knows to build an already loaded system,
+    // or the same system as an unchanged library before them, are not opened.
+    void fengin::FenginCore::loadSystemDir(std::string const &path, bool recursive, bool log, bool loadSymlinks)
+    {
+        FENGIN_INFO("Loading all systems in ", path);
+        std::vector<PluginManifest::Entry *> libraries;
+        collectSystemDir(path, recursive, log, loadSymlinks, libraries);
+        std::vector<std::string> paths;
+        std::vector<PluginManifest::Entry *> opened;
+        std::unordered_set<std::string> expected;
+        for (auto entry : libraries) {
+            auto const &system = manifest.systemOf(*entry);
+            if (!system.empty() && (main().hasSystem(system) || !expected.insert(system).second)) {
+                FENGIN_WARNING("[", system, "] already loaded, ignoring ", entry->path);
+                continue ;
+            }
+            paths.push_back(entry->path);
+            opened.push_back(entry);
+        }
+        const auto statuses = main().loadSystems(paths);
+        std::vector<std::string> loaded;
+        for (std::size_t i = 0; i < statuses.size(); i++) {
+            if (statuses[i].loaded) {
+                manifest.record(*opened[i], statuses[i].sysName);
+                loaded.push_back(paths[i]);
             }
-            if (!std::experimental::filesystem::is_directory(p.path())) {
-                const bool isSymlink = std::experimental::filesystem::is_symlink(p.path());
-                if ((loadSymlinks && isSymlink) || !isSymlink)
-                    loadSystem(p.path());
+        }
+        // The other worlds get their own instances of the same systems. The
+        // libraries are already mapped, so opening them again is cheap.
+        for (std::size_t i = 1; i < worlds.size(); i++)
+            worlds[i]->getManager().loadSystems(loaded);
+    }
+
+    void fengin::FenginCore::addWorlds(unsigned int count) {
+        while (worlds.size() < count) {
+            worlds.push_back(std::make_unique<World>(worlds.size()));
+            auto &manager = worlds.back()->getManager();
+            if (pool)
+                manager.provideThreadPool(*pool);
+            if (parameters.profileFrames > 0)
+                manager.enableProfiling(parameters.profileFrames);
+        }
+    }
+
+    bool fengin::FenginCore::anyRunning() const {
+        return std::any_of(worlds.begin(), worlds.end(), [](auto const &world) {
+            return world->isRunning();
+        });
+    }
+
+    int64_t fengin::FenginCore::framesRun() const {
+        int64_t frames = 0;
+        for (auto &world : worlds)
+            frames += static_cast<int64_t>(world->getFrames());
+        return frames;
+    }
+
+    void fengin::FenginCore::eachRunning(std::function<void(World &)> const &fun) {
+        if (!pool || worlds.size() == 1) {
+            for (auto &world : worlds) {
+                if (world->isRunning())
+                    fun(*world);
             }
+            return ;
         }
+        TaskGroup group;
+        for (auto &world : worlds) {
+            if (!world->isRunning())
+                continue ;
+            pool->run(group, [&fun, &world = *world]() {
+                try {
+                    fun(world);
+                } catch (std::exception const &error) {
+                    FENGIN_ERROR("[world ", world.getIndex(), "] Stopped : ", error.what());
+                    world.stop();
+                }
+            });
+        }
+        pool->wait(group);
     }
 
     int fengin::FenginCore::start(const StartParameters params) {
+        parameters = params;
+        Logger::inst().setLevel(params.logLevel);
+        const auto worldCount = std::max(1u, params.worlds);
+        if (params.threads > 0 || worldCount > 1) {
+            pool = params.threads > 0 ? std::make_unique<ThreadPool>(params.threads) : std::make_unique<ThreadPool>();
+            main().provideThreadPool(*pool);
+        }
+        if (params.profileFrames > 0)
+            main().enableProfiling(params.profileFrames);
+        addWorlds(worldCount);
+        if (!params.pluginManifest.empty())
+            manifest.load(params.pluginManifest);
         this->loadSystemDir(params.configFilePath, params.recursive, params.logWhenLoading, params.loadSymlinks);
-        const int numberOfSystems = core->getNumberOfSystems();
-        events->send<std::string>("Fender loaded " + std::to_string(numberOfSystems) + " systems.");
-        return core->run(); // this will init all systems
+        if (!params.pluginManifest.empty())
+            manifest.save(params.pluginManifest);
+        const int numberOfSystems = main().getNumberOfSystems();
+        for (auto &world : worlds)
+            world->getEvents().send<std::string>("Fender loaded " + std::to_string(numberOfSystems) + " systems.");
+        if (worlds.size() > 1)
+            FENGIN_INFO("Running ", worlds.size(), " worlds on ", pool->size(), " threads.");
+        eachRunning([](World &world) { world.getManager().run(); }); // this will init all systems
+        return 0;
+    }
+
+    int64_t fengin::FenginCore::runFree() {
+        const auto period = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(parameters.frameRate > 0 ? 1.0 / parameters.frameRate : 0.0));
+        auto next = Clock::now();
+        const auto budget = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(parameters.worldBudget));
+        while (anyRunning() && !interrupt) {
+            eachRunning([budget](World &world) { world.runFree(budget); });
+            if (period > Clock::duration::zero()) {
+                next = std::max(next + period, Clock::now() - period);
+                sleepUntil(next);
+            }
+        }
+        return framesRun();
+    }
+
+    // Accumulates real time and spends it in ticks of a fixed length, so the
+    // simulation does not depend on the machine's speed. Between iterations
+    // the thread sleeps until the next tick (or frame) is due.
+    int64_t fengin::FenginCore::runFixed() {
+        const double tickRate = parameters.tickRate > 0 ? parameters.tickRate : 60;
+        const auto step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / tickRate));
+        const auto framePeriod = parameters.frameRate > 0 ?
+                std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / parameters.frameRate)) : step;
+        FixedStep pace;
+        pace.step = step;
+        pace.framePeriod = framePeriod;
+        pace.budget = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(parameters.worldBudget));
+        pace.stepSeconds = static_cast<float>(1.0 / tickRate);
+        pace.maxTicks = std::max(1u, parameters.maxCatchUpTicks);
+        auto previous = Clock::now();
+        while (anyRunning() && !interrupt) {
+            const auto now = Clock::now();
+            const auto elapsed = now - previous;
+            previous = now;
+            eachRunning([&](World &world) { world.runFixed(now, elapsed, pace); });
+            // Every world keeps its own time, the loop wakes up for the earliest.
+            auto deadline = Clock::time_point::max();
+            for (auto &world : worlds) {
+                if (world->isRunning())
+                    deadline = std::min(deadline, world->getDeadline());
+            }
+            if (deadline != Clock::time_point::max())
+                sleepUntil(deadline);
+        }
+        return framesRun();
     }
 
     int fengin::FenginCore::run() {
-        int64_t runs = 0;
-        events->send<std::string>("Fender running...");
-        for (;core->getNumberOfSystems() > 0; runs++) {
-            if (core->run() != 0 || interrupt)
-                break ;
+        for (auto &world : worlds)
+            world->getEvents().send<std::string>("Fender running...");
+        const auto runs = parameters.loop == LoopMode::Fixed ? runFixed() : runFree();
+        for (auto &world : worlds) {
+            world->getEvents().send<std::string>("Fender shutting down. Ran " + std::to_string(runs) + " times.");
+            world->getEvents().send<events::Shutdown>();
+            world->getManager().cleanSystems();
+        }
+        for (auto &world : worlds) {
+            if (world->getOverruns() > 0)
+                FENGIN_WARNING("[world ", world->getIndex(), "] Went over budget ", world->getOverruns(), " times.");
         }
-        events->send<std::string>("Fender shutting down. Ran " + std::to_string(runs) + " times.");
-        events->send<events::Shutdown>();
-        core->cleanSystems();
         return 0;
     }
 }
\ No newline at end of file